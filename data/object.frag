@@ -1,5 +1,10 @@
 #version 410 core
 // simple object fragment shader
+// features are compiled in by #define, see Object::shaderFeatures:
+//   HAS_TEXTURE: color from ColorTexture
+//   HAS_TEXTURE_ARRAY: color from a layer of TextureArrays
+//   HAS_SPECULAR: material has a specular color
+//   STATIC_BATCH: material & color layer per vertex, instead of from ObjectData
 
 // per-frame data, must match in C++ and any shaders that use it
 layout(std140)                          // standard layout matching C++
@@ -12,14 +17,25 @@ uniform SceneData {                     // like a class name
 layout(std140)
 uniform ObjectData {
     mat4 WorldFromModel, ModelFromWorld;    // object matrices
-    vec3 Ambient; float pad0;               // ambient color & padding
-    vec3 Diffuse; float pad1;               // diffuse color & padding
-    vec4 Specular;                          // specular color and exponent
+    uint Material;                          // index into material arrays
+    int ColorArray;                         // TextureArrays entry, -1 for ColorTexture
+    int ColorLayer;                         // layer in that array
+};
+
+// all materials, array size must match MaterialLibrary::MAX_MATERIALS
+layout(std140)
+uniform MaterialData {
+    vec4 Ambient[256];                      // ambient color
+    vec4 Diffuse[256];                      // diffuse color
+    vec4 Specular[256];                     // specular color and exponent
 };
 
 // global per-object setting, outside of a uniform block
 uniform sampler2D ColorTexture;
 
+// packed textures for the whole scene, size must match TextureArray::MAX_ARRAYS
+uniform sampler2DArray TextureArrays[8];
+
 // input (must match vertex shader output)
 in vec2 texcoord;  // texture coordinate
 in vec3 normal;    // world-space normal
@@ -28,6 +44,16 @@ in vec4 position;  // world-space position
 // output to frame buffer
 out vec4 fragColor;
 
+// per-draw material & color layer
+#ifdef STATIC_BATCH
+flat in ivec2 drawData;
+#define MATERIAL drawData.x
+#define COLOR_LAYER drawData.y
+#else
+#define MATERIAL Material
+#define COLOR_LAYER ColorLayer
+#endif
+
 void main() {
     // lighting vectors
     vec3 N = normalize(normal);             // surface normal
@@ -38,16 +64,23 @@ void main() {
     float N_dot_H = max(0., dot(N, H));
 
     // ambient contribution
-    vec3 ambCol = Ambient * LightDir.a;
+    vec3 ambCol = Ambient[MATERIAL].rgb * LightDir.a;
 
     // diffuse or texture
-    vec3 diffCol = Diffuse;
-    if (textureSize(ColorTexture,0) != ivec2(1,1))
-        diffCol *= texture(ColorTexture, texcoord).rgb;
+    vec3 diffCol = Diffuse[MATERIAL].rgb;
+#if defined(HAS_TEXTURE_ARRAY)
+    diffCol *= texture(TextureArrays[ColorArray], vec3(texcoord, COLOR_LAYER)).rgb;
+#elif defined(HAS_TEXTURE)
+    diffCol *= texture(ColorTexture, texcoord).rgb;
+#endif
     diffCol *= N_dot_L;
 
     // specular
-    vec3 specCol = Specular.rgb * pow(N_dot_H, Specular.w) * N_dot_L;
+    vec3 specCol = vec3(0);
+#ifdef HAS_SPECULAR
+    vec4 Ks = Specular[MATERIAL];
+    specCol = Ks.rgb * pow(N_dot_H, Ks.w) * N_dot_L;
+#endif
 
     // final color
     fragColor = vec4(ambCol + diffCol + specCol, 1);
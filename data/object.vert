@@ -1,5 +1,6 @@
 #version 410 core
 // simple object vertex shader
+// STATIC_BATCH takes material & color layer per vertex, see StaticBatch
 
 // per-frame data, must match in C++ and any shaders that use it
 layout(std140)                          // standard layout matching C++
@@ -12,24 +13,41 @@ uniform SceneData {                     // like a class name
 layout(std140)
 uniform ObjectData {
     mat4 WorldFromModel, ModelFromWorld;    // object matrices
-    vec3 Ambient; float pad0;               // ambient color & padding
-    vec3 Diffuse; float pad1;               // diffuse color & padding
-    vec4 Specular;                          // specular color and exponent
+    uint Material;                          // index into material arrays
+    int ColorArray;                         // TextureArrays entry, -1 for ColorTexture
+    int ColorLayer;                         // layer in that array
 };
 
-// per-vertex input
-in vec2 vUV;        // vertex texture coordinate
-in vec3 vPosition;  // object-space position of vertex
-in vec3 vNormal;    // object-space normal at vertex
+// all materials, array size must match MaterialLibrary::MAX_MATERIALS
+layout(std140)
+uniform MaterialData {
+    vec4 Ambient[256];                      // ambient color
+    vec4 Diffuse[256];                      // diffuse color
+    vec4 Specular[256];                     // specular color and exponent
+};
+
+// per-vertex input, locations must match MeshBuffer
+layout(location = 0) in vec3 vPosition;  // object-space position of vertex
+layout(location = 1) in vec3 vNormal;    // object-space normal at vertex
+layout(location = 2) in vec2 vUV;        // vertex texture coordinate
+#ifdef STATIC_BATCH
+layout(location = 3) in ivec2 vDrawData; // material & color layer of merged draws
+#endif
 
 // output (must match fragment shader input)
 out vec2 texcoord;  // texture coordinate
 out vec3 normal;    // world-space normal
 out vec4 position;  // world-space position
+#ifdef STATIC_BATCH
+flat out ivec2 drawData;    // material & color layer
+#endif
 
 void main() {
     // just pass texture coordinate through
     texcoord = vUV;
+#ifdef STATIC_BATCH
+    drawData = vDrawData;
+#endif
 
     // homogeneous transform of position to world space
     position = WorldFromModel * vec4(vPosition, 1);
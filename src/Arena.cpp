@@ -0,0 +1,51 @@
+// bump allocator for short-lived data that is all freed at once
+
+#include "Arena.hpp"
+
+#include <new>
+#include <stdint.h>
+
+Arena::Arena(size_t blockSize) :
+    next(nullptr), limit(nullptr), blockSize(blockSize), used(0), reserved(0)
+{
+}
+
+void *Arena::allocate(size_t bytes, size_t align)
+{
+    // fits in current block?
+    char *start = (char*)((uintptr_t(next) + align - 1) & ~uintptr_t(align - 1));
+    if (next && bytes <= size_t(limit - start)) {
+        next = start + bytes;
+        used += bytes;
+        return start;
+    }
+
+    // large requests get a block of their own, leaving current block in use
+    if (bytes > blockSize / 2) {
+        size_t size = bytes + align;
+        char *block = (char*)::operator new(size);
+        blocks.push_back(block);
+        reserved += size;
+        used += bytes;
+        return (char*)((uintptr_t(block) + align - 1) & ~uintptr_t(align - 1));
+    }
+
+    // start a new block
+    char *block = (char*)::operator new(blockSize);
+    blocks.push_back(block);
+    reserved += blockSize;
+    start = (char*)((uintptr_t(block) + align - 1) & ~uintptr_t(align - 1));
+    next = start + bytes;
+    limit = block + blockSize;
+    used += bytes;
+    return start;
+}
+
+void Arena::release()
+{
+    for (void *block : blocks)
+        ::operator delete(block);
+    blocks.clear();
+    next = limit = nullptr;
+    used = reserved = 0;
+}
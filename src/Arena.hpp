@@ -0,0 +1,55 @@
+// bump allocator for short-lived data that is all freed at once
+//
+// Used for loader scratch arrays: allocation is a pointer bump, freeing a
+// single array does nothing, and release() returns everything together.
+// Not thread safe, use one arena per thread.
+#pragma once
+
+#include <stddef.h>
+#include <vector>
+
+class Arena {
+private:
+    std::vector<void*> blocks;      // every block allocated
+    char *next, *limit;             // free space in current block
+    size_t blockSize;               // default size for new blocks
+    size_t used, reserved;          // bytes handed out & bytes in blocks
+
+public:
+    Arena(size_t blockSize = 1 << 20);
+    ~Arena() { release(); }
+
+    // arena owns its blocks, so no copies
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    // allocate aligned memory, valid until release()
+    void *allocate(size_t bytes, size_t align = alignof(max_align_t));
+
+    // free all blocks at once
+    void release();
+
+    size_t bytesUsed() const { return used; }
+    size_t bytesReserved() const { return reserved; }
+    size_t numBlocks() const { return blocks.size(); }
+};
+
+// standard library allocator drawing from an arena
+// deallocate does nothing, so size containers up front with reserve()
+template <typename T>
+class ArenaAllocator {
+public:
+    typedef T value_type;
+    Arena *arena;
+
+    ArenaAllocator(Arena &arena) : arena(&arena) {}
+    template <typename U> ArenaAllocator(const ArenaAllocator<U> &other) : arena(other.arena) {}
+
+    T *allocate(size_t count) { return (T*)arena->allocate(count * sizeof(T), alignof(T)); }
+    void deallocate(T *, size_t) {}
+
+    template <typename U> bool operator==(const ArenaAllocator<U> &other) const { return arena == other.arena; }
+    template <typename U> bool operator!=(const ArenaAllocator<U> &other) const { return arena != other.arena; }
+};
+
+template <typename T> using ArenaVector = std::vector<T, ArenaAllocator<T>>;
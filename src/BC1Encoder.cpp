@@ -0,0 +1,212 @@
+// BC1 (DXT1) block compression and mipmap generation for RGB images
+//
+// Endpoints come from the block's color bounding box, inset slightly, and
+// each pixel takes the nearest of the four palette colors. The SSE2 path
+// finds the bounds and palette distances four pixels at a time and gives
+// results identical to the scalar path.
+
+#include "BC1Encoder.hpp"
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BC1_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace glm;  // avoid glm:: for all glm types and functions
+
+size_t bc1Size(int width, int height)
+{
+    return size_t((width + 3) / 4) * ((height + 3) / 4) * 8;
+}
+
+// gather 4x4 block as RGBX, repeating the last row/column past the image edge
+static void loadBlock(const u8vec3 *pixels, ptrdiff_t rowStride, int width, int height,
+    int bx, int by, uint8_t block[16][4])
+{
+    for (int y = 0; y < 4; ++y) {
+        const u8vec3 *row = pixels + rowStride * std::min(by + y, height - 1);
+        for (int x = 0; x < 4; ++x) {
+            const u8vec3 &p = row[std::min(bx + x, width - 1)];
+            block[4*y + x][0] = p.r;
+            block[4*y + x][1] = p.g;
+            block[4*y + x][2] = p.b;
+            block[4*y + x][3] = 0;
+        }
+    }
+}
+
+// pack to and expand from 5:6:5 bit color
+static inline uint16_t to565(const int rgb[3])
+{
+    return uint16_t((rgb[0] >> 3) << 11 | (rgb[1] >> 2) << 5 | (rgb[2] >> 3));
+}
+static inline void from565(uint16_t c, int rgb[3])
+{
+    int r = c >> 11, g = (c >> 5) & 63, b = c & 31;
+    rgb[0] = r << 3 | r >> 2;
+    rgb[1] = g << 2 | g >> 4;
+    rgb[2] = b << 3 | b >> 2;
+}
+
+// endpoints from color bounds, inset by 1/16 of the range to cut average error
+// fills the 4-color palette in index order, returns false for a solid block
+static bool chooseEndpoints(const uint8_t lo[4], const uint8_t hi[4],
+    uint16_t &c0, uint16_t &c1, int palette[4][3])
+{
+    int mn[3], mx[3];
+    for (int c = 0; c < 3; ++c) {
+        int inset = (hi[c] - lo[c]) >> 4;
+        mn[c] = lo[c] + inset;
+        mx[c] = hi[c] - inset;
+    }
+
+    // each field of max >= min, so c0 >= c1
+    // equal endpoints would select 3-color mode, so draw solid with index 0
+    c0 = to565(mx);
+    c1 = to565(mn);
+    if (c0 == c1) return false;
+
+    from565(c0, palette[0]);
+    from565(c1, palette[1]);
+    for (int c = 0; c < 3; ++c) {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+    return true;
+}
+
+// little-endian block: color0, color1, then 2 bits per pixel
+static void writeBlock(uint16_t c0, uint16_t c1, uint32_t indices, uint8_t *out)
+{
+    out[0] = uint8_t(c0);  out[1] = uint8_t(c0 >> 8);
+    out[2] = uint8_t(c1);  out[3] = uint8_t(c1 >> 8);
+    for (int i = 0; i < 4; ++i)
+        out[4 + i] = uint8_t(indices >> 8 * i);
+}
+
+#ifdef BC1_SSE2
+// squared distance from four RGBX pixels, as 16-bit lo & hi halves, to pal
+static inline __m128i distance4(__m128i lo, __m128i hi, __m128i pal)
+{
+    __m128i dlo = _mm_sub_epi16(lo, pal), dhi = _mm_sub_epi16(hi, pal);
+    __m128 mlo = _mm_castsi128_ps(_mm_madd_epi16(dlo, dlo));   // r²+g², b² per pixel
+    __m128 mhi = _mm_castsi128_ps(_mm_madd_epi16(dhi, dhi));
+    __m128i rg = _mm_castps_si128(_mm_shuffle_ps(mlo, mhi, _MM_SHUFFLE(2,0,2,0)));
+    __m128i b = _mm_castps_si128(_mm_shuffle_ps(mlo, mhi, _MM_SHUFFLE(3,1,3,1)));
+    return _mm_add_epi32(rg, b);
+}
+
+static void encodeBlock(const uint8_t block[16][4], uint8_t *out)
+{
+    __m128i px[4];
+    for (int i = 0; i < 4; ++i)
+        px[i] = _mm_loadu_si128((const __m128i*)block[4*i]);
+
+    // per-channel bounds, reduced across the four pixels in each register
+    __m128i mn = _mm_min_epu8(_mm_min_epu8(px[0], px[1]), _mm_min_epu8(px[2], px[3]));
+    __m128i mx = _mm_max_epu8(_mm_max_epu8(px[0], px[1]), _mm_max_epu8(px[2], px[3]));
+    mn = _mm_min_epu8(mn, _mm_shuffle_epi32(mn, _MM_SHUFFLE(1,0,3,2)));
+    mx = _mm_max_epu8(mx, _mm_shuffle_epi32(mx, _MM_SHUFFLE(1,0,3,2)));
+    mn = _mm_min_epu8(mn, _mm_shuffle_epi32(mn, _MM_SHUFFLE(2,3,0,1)));
+    mx = _mm_max_epu8(mx, _mm_shuffle_epi32(mx, _MM_SHUFFLE(2,3,0,1)));
+    uint32_t lo32 = uint32_t(_mm_cvtsi128_si32(mn)), hi32 = uint32_t(_mm_cvtsi128_si32(mx));
+    uint8_t lo[4] = {uint8_t(lo32), uint8_t(lo32 >> 8), uint8_t(lo32 >> 16), 0};
+    uint8_t hi[4] = {uint8_t(hi32), uint8_t(hi32 >> 8), uint8_t(hi32 >> 16), 0};
+
+    uint16_t c0, c1;
+    int palette[4][3];
+    if (!chooseEndpoints(lo, hi, c0, c1, palette)) {
+        writeBlock(c0, c1, 0, out);
+        return;
+    }
+
+    __m128i pal[4];
+    for (int k = 0; k < 4; ++k)
+        pal[k] = _mm_setr_epi16(short(palette[k][0]), short(palette[k][1]), short(palette[k][2]), 0,
+            short(palette[k][0]), short(palette[k][1]), short(palette[k][2]), 0);
+
+    // nearest palette entry, lowest index on ties
+    uint32_t indices = 0;
+    const __m128i zero = _mm_setzero_si128();
+    for (int i = 0; i < 4; ++i) {
+        __m128i lo16 = _mm_unpacklo_epi8(px[i], zero), hi16 = _mm_unpackhi_epi8(px[i], zero);
+        __m128i best = distance4(lo16, hi16, pal[0]), index = zero;
+        for (int k = 1; k < 4; ++k) {
+            __m128i dist = distance4(lo16, hi16, pal[k]);
+            __m128i closer = _mm_cmplt_epi32(dist, best);
+            best = _mm_or_si128(_mm_and_si128(closer, dist), _mm_andnot_si128(closer, best));
+            index = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(k)), _mm_andnot_si128(closer, index));
+        }
+
+        // gather 2-bit indices for these four pixels
+        index = _mm_or_si128(index, _mm_srli_epi64(index, 30));
+        uint32_t pair0 = uint32_t(_mm_cvtsi128_si32(index));
+        uint32_t pair1 = uint32_t(_mm_cvtsi128_si32(_mm_unpackhi_epi64(index, index)));
+        indices |= ((pair0 & 15) | (pair1 & 15) << 4) << 8 * i;
+    }
+    writeBlock(c0, c1, indices, out);
+}
+
+#else
+static void encodeBlock(const uint8_t block[16][4], uint8_t *out)
+{
+    uint8_t lo[4] = {255, 255, 255, 0}, hi[4] = {0, 0, 0, 0};
+    for (int i = 0; i < 16; ++i)
+        for (int c = 0; c < 3; ++c) {
+            lo[c] = std::min(lo[c], block[i][c]);
+            hi[c] = std::max(hi[c], block[i][c]);
+        }
+
+    uint16_t c0, c1;
+    int palette[4][3];
+    if (!chooseEndpoints(lo, hi, c0, c1, palette)) {
+        writeBlock(c0, c1, 0, out);
+        return;
+    }
+
+    // nearest palette entry, lowest index on ties
+    uint32_t indices = 0;
+    for (int i = 0; i < 16; ++i) {
+        int bestIndex = 0, bestDist = 0x7fffffff;
+        for (int k = 0; k < 4; ++k) {
+            int dr = block[i][0] - palette[k][0];
+            int dg = block[i][1] - palette[k][1];
+            int db = block[i][2] - palette[k][2];
+            int dist = dr*dr + dg*dg + db*db;
+            if (dist < bestDist) {
+                bestDist = dist;
+                bestIndex = k;
+            }
+        }
+        indices |= uint32_t(bestIndex) << 2 * i;
+    }
+    writeBlock(c0, c1, indices, out);
+}
+#endif
+
+void encodeBC1(const u8vec3 *pixels, ptrdiff_t rowStride, int width, int height, uint8_t *blocks)
+{
+    uint8_t block[16][4];
+    for (int by = 0; by < height; by += 4)
+        for (int bx = 0; bx < width; bx += 4) {
+            loadBlock(pixels, rowStride, width, height, bx, by, block);
+            encodeBlock(block, blocks);
+            blocks += 8;
+        }
+}
+
+void downsample(const u8vec3 *pixels, ptrdiff_t rowStride, int width, int height, u8vec3 *out)
+{
+    int outWidth = std::max(width / 2, 1), outHeight = std::max(height / 2, 1);
+    for (int y = 0; y < outHeight; ++y) {
+        const u8vec3 *row0 = pixels + rowStride * std::min(2 * y, height - 1);
+        const u8vec3 *row1 = pixels + rowStride * std::min(2 * y + 1, height - 1);
+        for (int x = 0; x < outWidth; ++x) {
+            int x0 = std::min(2 * x, width - 1), x1 = std::min(2 * x + 1, width - 1);
+            uvec3 sum = uvec3(row0[x0]) + uvec3(row0[x1]) + uvec3(row1[x0]) + uvec3(row1[x1]);
+            *out++ = u8vec3((sum + 2u) / 4u);
+        }
+    }
+}
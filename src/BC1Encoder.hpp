@@ -0,0 +1,21 @@
+// BC1 (DXT1) block compression and mipmap generation for RGB images
+//
+// Images are addressed by a first row and a row stride in pixels, so a
+// negative stride walks a top-first image bottom up without copying it.
+#pragma once
+
+#include <glm/glm.hpp>
+#include <stddef.h>
+#include <stdint.h>
+
+// bytes of BC1 data for an image: 8 per 4x4 block, partial blocks padded
+size_t bc1Size(int width, int height);
+
+// compress an image into bc1Size(width, height) bytes of blocks
+void encodeBC1(const glm::u8vec3 *pixels, ptrdiff_t rowStride, int width, int height,
+    uint8_t *blocks);
+
+// box-filter an image to the next mip level, tightly packed in out
+// out holds max(width/2,1) x max(height/2,1) pixels
+void downsample(const glm::u8vec3 *pixels, ptrdiff_t rowStride, int width, int height,
+    glm::u8vec3 *out);
@@ -0,0 +1,451 @@
+// bounding volume hierarchy over world-space triangles, for ray queries
+
+#include "BVH.hpp"
+
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <math.h>
+
+using namespace glm;  // avoid glm:: for all glm types and functions
+
+// axis-aligned box, empty until it grows to hold something
+struct Bounds {
+    vec3 lo = vec3(INFINITY), hi = vec3(-INFINITY);
+
+    void grow(vec3 p) { lo = min(lo, p); hi = max(hi, p); }
+    void grow(const Bounds &b) { lo = min(lo, b.lo); hi = max(hi, b.hi); }
+
+    // half the surface area, proportional to the chance a ray hits it
+    float area() const {
+        vec3 d = hi - lo;
+        return d.x < 0 ? 0 : d.x * d.y + d.y * d.z + d.z * d.x;
+    }
+};
+
+// per-triangle data used while building
+struct BuildTriangle {
+    Bounds bounds;
+    vec3 centroid;
+};
+
+// packet tests for a leaf of count triangles
+static inline float packetsFor(uint32_t count)
+{
+    return float((count + TrianglePacket::WIDTH - 1) / TrianglePacket::WIDTH);
+}
+
+// builds nodes for a range of the triangle order
+class Builder {
+public:
+    std::vector<BVH::Node> &nodes;
+    const std::vector<BuildTriangle> &tris;
+    std::vector<uint32_t> &order;
+    unsigned int depth;
+
+    Builder(std::vector<BVH::Node> &nodes, const std::vector<BuildTriangle> &tris,
+        std::vector<uint32_t> &order) :
+        nodes(nodes), tris(tris), order(order), depth(0) {}
+
+    void build(uint32_t begin, uint32_t end, unsigned int level);
+};
+
+void Builder::build(uint32_t begin, uint32_t end, unsigned int level)
+{
+    depth = std::max(depth, level);
+    size_t nodeIndex = nodes.size();
+    nodes.push_back({});
+
+    Bounds bounds, centroids;
+    for (uint32_t i = begin; i < end; ++i) {
+        bounds.grow(tris[order[i]].bounds);
+        centroids.grow(tris[order[i]].centroid);
+    }
+    nodes[nodeIndex].lo = bounds.lo;
+    nodes[nodeIndex].hi = bounds.hi;
+    uint32_t count = end - begin;
+
+    // cheapest split over binned centroids on every axis
+    // cost is packets tested, weighted by the chance of entering each side
+    float bestCost = INFINITY;
+    int bestAxis = -1, bestBin = 0;
+    vec3 extent = centroids.hi - centroids.lo;
+    for (int axis = 0; axis < 3 && level < BVH::MAX_DEPTH; ++axis) {
+        if (extent[axis] <= 0) continue;
+        float scale = BVH::BINS / extent[axis];
+
+        Bounds binBounds[BVH::BINS];
+        uint32_t binCount[BVH::BINS] = {};
+        for (uint32_t i = begin; i < end; ++i) {
+            const BuildTriangle &tri = tris[order[i]];
+            int bin = std::min(int((tri.centroid[axis] - centroids.lo[axis]) * scale), BVH::BINS - 1);
+            binBounds[bin].grow(tri.bounds);
+            ++binCount[bin];
+        }
+
+        // sweep from the right for the cost of everything past each bin
+        float rightCost[BVH::BINS];
+        Bounds right;
+        uint32_t rightCount = 0;
+        for (int bin = BVH::BINS - 1; bin > 0; --bin) {
+            right.grow(binBounds[bin]);
+            rightCount += binCount[bin];
+            rightCost[bin] = right.area() * packetsFor(rightCount);
+        }
+        Bounds left;
+        uint32_t leftCount = 0;
+        for (int bin = 0; bin < BVH::BINS - 1; ++bin) {
+            left.grow(binBounds[bin]);
+            leftCount += binCount[bin];
+            float cost = left.area() * packetsFor(leftCount) + rightCost[bin + 1];
+            if (leftCount && leftCount < count && cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestBin = bin;
+            }
+        }
+    }
+
+    // one node traversal costs about as much as one packet test
+    // small nodes stay leaves when testing all their packets is cheaper
+    float leafCost = bounds.area() * packetsFor(count);
+    bool split = bestAxis >= 0 && (count > BVH::MAX_LEAF || bestCost + bounds.area() < leafCost);
+    if (!split) {
+        nodes[nodeIndex].index = begin;
+        nodes[nodeIndex].count = count;
+        return;
+    }
+
+    float scale = BVH::BINS / extent[bestAxis];
+    uint32_t *middle = std::partition(&order[begin], &order[begin] + count, [&](uint32_t t) {
+        int bin = std::min(int((tris[t].centroid[bestAxis] - centroids.lo[bestAxis]) * scale), BVH::BINS - 1);
+        return bin <= bestBin;
+    });
+    uint32_t mid = uint32_t(middle - &order[0]);
+
+    // first child follows its parent, second child's position is stored
+    build(begin, mid, level + 1);
+    nodes[nodeIndex].index = uint32_t(nodes.size());
+    nodes[nodeIndex].count = 0;
+    build(mid, end, level + 1);
+}
+
+void BVH::build(const std::vector<vec3> &triangleCorners)
+{
+    double start = glfwGetTime();
+    nodes.clear();
+    packets.clear();
+    triangles.clear();
+    corners.clear();
+    depth = 0;
+
+    size_t count = triangleCorners.size() / 3;
+    std::vector<BuildTriangle> tris(count);
+    std::vector<uint32_t> order(count);
+    for (size_t i = 0; i < count; ++i) {
+        for (int c = 0; c < 3; ++c)
+            tris[i].bounds.grow(triangleCorners[3 * i + c]);
+        tris[i].centroid = 0.5f * (tris[i].bounds.lo + tris[i].bounds.hi);
+        order[i] = uint32_t(i);
+    }
+
+    if (count) {
+        // a binary tree has fewer than 2 nodes per leaf
+        nodes.reserve(2 * count);
+        Builder builder(nodes, tris, order);
+        builder.build(0, uint32_t(count), 1);
+        depth = builder.depth;
+    }
+
+    // pack each leaf's triangles, so a leaf reads one contiguous run
+    for (Node &node : nodes) {
+        if (!node.count) continue;
+        uint32_t first = node.index;
+        node.index = uint32_t(packets.size());
+        for (uint32_t i = 0; i < node.count; ++i) {
+            int lane = int(i % TrianglePacket::WIDTH);
+            if (lane == 0) {
+                packets.emplace_back();
+                triangles.resize(packets.size() * TrianglePacket::WIDTH, ~0u);
+                corners.resize(3 * packets.size() * TrianglePacket::WIDTH, vec3(NAN));
+            }
+            uint32_t t = order[first + i];
+            size_t slot = (packets.size() - 1) * TrianglePacket::WIDTH + lane;
+            packets.back().set(lane, TrianglePacket::face(triangleCorners[3 * t],
+                triangleCorners[3 * t + 1], triangleCorners[3 * t + 2]));
+            triangles[slot] = t;
+            for (int c = 0; c < 3; ++c)
+                corners[3 * slot + c] = triangleCorners[3 * t + c];
+        }
+    }
+    numTriangles = count;
+
+    buildTime = glfwGetTime() - start;
+}
+
+// distance at which ray enters box within [tmin, tmax], infinity if it misses
+// NaN from a ray lying in a slab's plane is dropped by the min/max, so that slab
+// doesn't limit the range: the test stays conservative and the ray can still enter
+static inline float enter(const BVH::Node &node, vec3 rayStart, vec3 invDir, float tmin, float tmax)
+{
+    vec3 t0 = (node.lo - rayStart) * invDir, t1 = (node.hi - rayStart) * invDir;
+    vec3 tnear = min(t0, t1), tfar = max(t0, t1);
+    float in = std::max(tmin, std::max(tnear.x, std::max(tnear.y, tnear.z)));
+    float out = std::min(tmax, std::min(tfar.x, std::min(tfar.y, tfar.z)));
+    return in <= out ? in : INFINITY;
+}
+
+bool BVH::closest(vec3 rayStart, vec3 rayDir, float tmin, float tmax, Hit &hit) const
+{
+    if (nodes.empty()) return false;
+    vec3 invDir = vec3(1) / rayDir;
+    if (enter(nodes[0], rayStart, invDir, tmin, tmax) == INFINITY) return false;
+
+    float best = tmax;
+    uint32_t bestLane = ~0u;
+    uint32_t stack[MAX_DEPTH + 1];
+    int top = 0;
+    uint32_t n = 0;
+    for (;;) {
+        const Node &node = nodes[n];
+        if (node.count) {
+            uint32_t end = node.index + (node.count + TrianglePacket::WIDTH - 1) / TrianglePacket::WIDTH;
+            for (uint32_t p = node.index; p < end; ++p) {
+                int lane = packets[p].intersect(rayStart, rayDir, tmin, best);
+                if (lane >= 0) bestLane = p * TrianglePacket::WIDTH + lane;
+            }
+        }
+        else {
+            // visit the nearer child first, so the farther one is often culled
+            uint32_t a = n + 1, b = node.index;
+            float ta = enter(nodes[a], rayStart, invDir, tmin, best);
+            float tb = enter(nodes[b], rayStart, invDir, tmin, best);
+            if (tb < ta) { std::swap(a, b); std::swap(ta, tb); }
+            if (ta != INFINITY) {
+                if (tb != INFINITY) stack[top++] = b;
+                n = a;
+                continue;
+            }
+        }
+
+        // next deferred node still in range
+        for (;;) {
+            if (top == 0) {
+                if (bestLane == ~0u) return false;
+                hit.t = best;
+                hit.triangle = triangles[bestLane];
+                return true;
+            }
+            n = stack[--top];
+            if (enter(nodes[n], rayStart, invDir, tmin, best) != INFINITY) break;
+        }
+    }
+}
+
+// first t in [0, tmax] where a t^2 + b t + c reaches 0 from above, for a >= 0
+// c < 0 means already inside, which counts at t = 0 only while heading deeper
+static inline bool firstTouch(float a, float b, float c, float tmax, float &t)
+{
+    if (c < 0) {
+        t = 0;
+        return b < 0;
+    }
+    // both roots have the same sign, so only the smaller one can count
+    float det = b * b - 4 * a * c;
+    if (!(a > 0 && det >= 0)) return false;
+    t = (-b - sqrtf(det)) / (2 * a);
+    return t >= 0 && t <= tmax;
+}
+
+// face stage of a sphere sweeping against a triangle, from center by fractions of move
+// on touching the face by best, lowers best, sets normal toward the sphere and returns true
+// otherwise sets edgeTime to when its edges & corners first could be touched, or INFINITY
+static bool sweepFace(const TrianglePacket::Face &f, vec3 center, float radius, vec3 move,
+    float &best, vec3 &normal, float &edgeTime)
+{
+    edgeTime = INFINITY;
+
+    // distance from plane, on whichever side the sphere starts
+    vec3 N = f.N;
+    float dist = dot(N, center) - f.V0_dot_N;
+    float approach = dot(N, move);
+    if (dist < 0) {
+        N = -N;
+        dist = -dist;
+        approach = -approach;
+    }
+    if (!(dist + std::min(0.f, approach) * best <= radius))
+        return false;   // doesn't get within radius of the plane in time
+    if (!(approach < 0)) {
+        // already within radius, not getting closer
+        // only edges & corners can stop it, unless it already overlaps the face
+        vec3 P = center - N * dist;
+        float a = dot(f.Na, P) - f.Ca;
+        float b = dot(f.Nb, P) - f.Cb;
+        if (!(a >= 0 && b >= 0 && a + b <= 1)) edgeTime = 0;
+        return false;
+    }
+
+    // when the sphere reaches the plane, or now if it is already there
+    float t = std::max(0.f, (dist - radius) / -approach);
+    vec3 P = center + move * t - N * (dist + approach * t);
+    float a = dot(f.Na, P) - f.Ca;
+    float b = dot(f.Nb, P) - f.Cb;
+    if (t <= best && a >= 0 && b >= 0 && a + b <= 1) {
+        best = t;
+        normal = N;
+        return true;
+    }
+    edgeTime = t;
+    return false;
+}
+
+// edge & corner stage, for triangles whose face wasn't touched
+// on contact, lowers best, sets normal toward the sphere and returns true
+static bool sweepEdges(const vec3 *corner, vec3 center, float radius, vec3 move,
+    float &best, vec3 &normal)
+{
+    // already overlapping an edge or corner: stop now if moving toward it, never otherwise
+    // sweepFace has handled overlapping the face
+    float radiusSq = radius * radius, nearestSq = INFINITY;
+    vec3 nearest;
+    for (int i = 0; i < 3; ++i) {
+        vec3 start = center - corner[i], edge = corner[(i + 1) % 3] - corner[i];
+        float edgeSq = dot(edge, edge);
+        float along = edgeSq > 0 ? std::min(1.f, std::max(0.f, dot(edge, start) / edgeSq)) : 0;
+        vec3 away = start - edge * along;
+        if (dot(away, away) < nearestSq) {
+            nearestSq = dot(away, away);
+            nearest = away;
+        }
+    }
+    if (nearestSq < radiusSq) {
+        if (!(dot(move, nearest) < 0)) return false;
+        best = 0;
+        normal = normalize(nearest);
+        return true;
+    }
+
+    // positions relative to the start of each edge
+    bool hit = false;
+    float moveSq = dot(move, move);
+    for (int i = 0; i < 3; ++i) {
+        vec3 start = center - corner[i];
+        float t;
+
+        // corner: |start + move t| = radius
+        float b = 2 * dot(move, start);
+        float c = dot(start, start) - radiusSq;
+        if (firstTouch(moveSq, b, c, best, t)) {
+            best = t;
+            normal = normalize(start + move * t);
+            hit = true;
+        }
+
+        // edge: distance from the line through it = radius, within the edge
+        vec3 edge = corner[(i + 1) % 3] - corner[i];
+        float edgeSq = dot(edge, edge), edgeDotMove = dot(edge, move), edgeDotStart = dot(edge, start);
+        float A = edgeSq * moveSq - edgeDotMove * edgeDotMove;
+        float B = 2 * (edgeSq * dot(move, start) - edgeDotMove * edgeDotStart);
+        float C = edgeSq * (dot(start, start) - radiusSq) - edgeDotStart * edgeDotStart;
+        if (!firstTouch(A, B, C, best, t))
+            continue;
+        float along = (edgeDotStart + edgeDotMove * t) / edgeSq;
+        if (along >= 0 && along <= 1) {
+            best = t;
+            normal = normalize(start + move * t - edge * along);
+            hit = true;
+        }
+    }
+    return hit;
+}
+
+bool BVH::sweepTriangle(vec3 v0, vec3 v1, vec3 v2,
+    vec3 center, float radius, vec3 move, float &t, vec3 &normal)
+{
+    if (move == vec3(0)) return false;
+    vec3 corner[3] = {v0, v1, v2};
+    float edgeTime;
+    if (sweepFace(TrianglePacket::face(v0, v1, v2), center, radius, move, t, normal, edgeTime))
+        return true;
+    return edgeTime < t && sweepEdges(corner, center, radius, move, t, normal);
+}
+
+bool BVH::sweep(vec3 center, float radius, vec3 move, Contact &contact) const
+{
+    if (nodes.empty() || move == vec3(0)) return false;
+    vec3 invDir = vec3(1) / move;
+
+    // boxes grown by the radius hold every center position that touches them
+    vec3 grow(radius);
+    auto enterGrown = [&](const Node &node, float tmax) {
+        Node grown = {node.lo - grow, 0, node.hi + grow, 0};
+        return enter(grown, center, invDir, 0, tmax);
+    };
+
+    float best = 1;
+    vec3 bestNormal(0);
+    uint32_t bestSlot = NO_HIT;
+
+    // edges are tested after faces, since a face contact usually rules them out
+    // on a wall split into many triangles, only one face is touched first
+    struct Pending { uint32_t slot; float edgeTime; };
+    Pending pending[64];
+    int numPending = 0;
+    auto testEdges = [&]() {
+        for (int i = 0; i < numPending; ++i)
+            if (pending[i].edgeTime < best &&
+                sweepEdges(&corners[3 * pending[i].slot], center, radius, move, best, bestNormal))
+                bestSlot = pending[i].slot;
+        numPending = 0;
+    };
+
+    uint32_t stack[MAX_DEPTH + 1];
+    int top = 0;
+    uint32_t n = 0;
+    if (enterGrown(nodes[0], best) == INFINITY) return false;
+    for (;;) {
+        const Node &node = nodes[n];
+        if (node.count) {
+            uint32_t first = node.index * TrianglePacket::WIDTH;
+            for (uint32_t slot = first; slot < first + node.count; ++slot) {
+                const TrianglePacket &packet = packets[slot / TrianglePacket::WIDTH];
+                float edgeTime;
+                if (sweepFace(packet.get(int(slot % TrianglePacket::WIDTH)),
+                        center, radius, move, best, bestNormal, edgeTime))
+                    bestSlot = slot;
+                else if (edgeTime < best) {
+                    if (numPending == int(sizeof(pending) / sizeof(pending[0]))) testEdges();
+                    pending[numPending++] = {slot, edgeTime};
+                }
+            }
+        }
+        else {
+            // nearer child first, as for rays
+            uint32_t a = n + 1, b = node.index;
+            float ta = enterGrown(nodes[a], best), tb = enterGrown(nodes[b], best);
+            if (tb < ta) { std::swap(a, b); std::swap(ta, tb); }
+            if (ta != INFINITY) {
+                if (tb != INFINITY) stack[top++] = b;
+                n = a;
+                continue;
+            }
+        }
+
+        // next deferred node still reached before the best contact
+        for (;;) {
+            if (top == 0) {
+                testEdges();
+                if (bestSlot == NO_HIT) return false;
+                vec3 rest = move * (1 - best);
+                contact.t = best;
+                contact.normal = bestNormal;
+                contact.slide = rest - bestNormal * std::min(0.f, dot(rest, bestNormal));
+                contact.triangle = triangles[bestSlot];
+                return true;
+            }
+            n = stack[--top];
+            if (enterGrown(nodes[n], best) != INFINITY) break;
+        }
+    }
+}
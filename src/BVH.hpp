@@ -0,0 +1,76 @@
+// bounding volume hierarchy over world-space triangles, for ray and sphere queries
+//
+// Built top down, splitting each node where the surface area heuristic
+// says rays will test the fewest packets, using binned centroids. Nodes
+// are flattened depth first into one array: a node's first child follows
+// it directly, and only the second child's position is stored. Each leaf's
+// triangles are packed into TrianglePackets, tested eight at a time.
+#pragma once
+
+#include "TrianglePacket.hpp"
+#include <glm/glm.hpp>
+#include <stdint.h>
+#include <vector>
+
+class BVH {
+public:
+    // leaves hold up to MAX_LEAF triangles, one packet's worth
+    // nodes are split at one of BINS candidates per axis
+    // nodes below MAX_DEPTH are always leaves, so traversal stacks stay small
+    enum { MAX_LEAF = TrianglePacket::WIDTH, BINS = 16, MAX_DEPTH = 48 };
+
+    // flattened node, two per cache line
+    struct Node {
+        glm::vec3 lo; uint32_t index;   // inner: second child node, leaf: first packet
+        glm::vec3 hi; uint32_t count;   // triangles in leaf, 0 for inner nodes
+    };
+    std::vector<Node> nodes;            // root first
+
+    // leaf triangles, each leaf starting a new packet
+    std::vector<TrianglePacket> packets;
+    std::vector<uint32_t> triangles;    // triangle in build() order for each packet lane
+    std::vector<glm::vec3> corners;     // 3 per packet lane, for sphere sweeps, NaN if unused
+
+    // hit found by a query
+    struct Hit {
+        float t;                        // distance along the ray, in ray direction units
+        uint32_t triangle;              // index of the triangle in build() order, or NO_HIT
+    };
+    static const uint32_t NO_HIT = ~0u;
+
+    // first contact of a sphere swept along a move
+    struct Contact {
+        float t;                        // fraction of the move made before touching, in [0, 1]
+        glm::vec3 normal;               // unit vector from the touching point to the sphere center
+        glm::vec3 slide;                // rest of the move, with the part into the surface removed
+        uint32_t triangle;              // index of the triangle in build() order
+    };
+
+    // statistics from the last build
+    size_t numTriangles;                // triangles given to build()
+    unsigned int depth;                 // deepest leaf, root is 1
+    double buildTime;                   // seconds
+
+public:
+    BVH() : numTriangles(0), depth(0), buildTime(0) {}
+
+    // build over triangles given as 3 corners each
+    void build(const std::vector<glm::vec3> &triangleCorners);
+
+    bool empty() const { return nodes.empty(); }
+
+    // closest hit with t in [tmin, tmax]
+    // returns false, leaving hit unchanged, if there is none
+    bool closest(glm::vec3 rayStart, glm::vec3 rayDir, float tmin, float tmax, Hit &hit) const;
+
+    // first triangle face, edge or corner touched by a sphere moving from center by move
+    // triangles are solid from both sides, and ones the sphere starts inside
+    // only stop motion toward them, so it can always back out
+    // returns false, leaving contact unchanged, if the whole move is clear
+    bool sweep(glm::vec3 center, float radius, glm::vec3 move, Contact &contact) const;
+
+    // same test against one triangle without the tree, the reference for sweep()
+    // on contact before t, sets t and normal and returns true
+    static bool sweepTriangle(glm::vec3 v0, glm::vec3 v1, glm::vec3 v2,
+        glm::vec3 center, float radius, glm::vec3 move, float &t, glm::vec3 &normal);
+};
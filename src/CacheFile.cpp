@@ -0,0 +1,56 @@
+// helpers shared by the on-disk caches in PROJECT_CACHE_DIR
+
+#include "CacheFile.hpp"
+#include "config.h"
+
+#include <stdio.h>
+#include <string>
+
+void fileStamp(const std::filesystem::path &path, uint64_t &size, int64_t &mtime)
+{
+    std::error_code err;
+    size = std::filesystem::file_size(path, err);
+    if (!err) mtime = std::filesystem::last_write_time(path, err).time_since_epoch().count();
+    if (err) {
+        size = MISSING_FILE;
+        mtime = 0;
+    }
+}
+
+uint64_t hashBytes(const void *data, size_t bytes, uint64_t hash)
+{
+    const uint8_t *p = (const uint8_t*)data;
+    for (size_t i = 0; i < bytes; ++i) {
+        hash ^= p[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+std::filesystem::path cacheFileFor(const std::filesystem::path &source, const char *extension)
+{
+    std::string name = source.u8string();
+    uint64_t hash = hashBytes(name.data(), name.size());
+
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), "-%016llx", (unsigned long long)hash);
+    return std::filesystem::path(PROJECT_CACHE_DIR) / (source.stem().u8string() + suffix + extension);
+}
+
+bool writeCacheFile(const std::filesystem::path &cachePath, const void *data, size_t bytes)
+{
+    std::error_code err;
+    std::filesystem::create_directories(cachePath.parent_path(), err);
+    std::filesystem::path tempPath = cachePath;
+    tempPath += ".tmp";
+    FILE *fp = fopen(tempPath.u8string().c_str(), "wb");
+    bool written = fp && fwrite(data, 1, bytes, fp) == bytes;
+    if (fp) written = (fclose(fp) == 0) && written;
+    if (written) std::filesystem::rename(tempPath, cachePath, err);
+    if (!written || err) {
+        fprintf(stderr, "can't write cache %s\n", cachePath.string().c_str());
+        std::filesystem::remove(tempPath, err);
+        return false;
+    }
+    return true;
+}
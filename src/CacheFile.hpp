@@ -0,0 +1,23 @@
+// helpers shared by the on-disk caches in PROJECT_CACHE_DIR
+#pragma once
+
+#include <filesystem>
+#include <stddef.h>
+#include <stdint.h>
+
+// stamp size for a missing source file, so a cache stays valid until it appears
+static const uint64_t MISSING_FILE = ~uint64_t(0);
+
+// size and modification time of a source file
+void fileStamp(const std::filesystem::path &path, uint64_t &size, int64_t &mtime);
+
+// 64-bit FNV-1a hash of data, continuing from an earlier hash if given
+uint64_t hashBytes(const void *data, size_t bytes, uint64_t hash = 14695981039346656037ull);
+
+// cache file for a source, named by a hash of its full path
+// extension includes the dot, e.g. ".mesh"
+std::filesystem::path cacheFileFor(const std::filesystem::path &source, const char *extension);
+
+// write a complete cache file, through a temporary name so no one sees a
+// partial file, returns false with a message on failure
+bool writeCacheFile(const std::filesystem::path &cachePath, const void *data, size_t bytes);
@@ -0,0 +1,126 @@
+// BC1 compressed copy of a PPM image with its full mipmap chain
+
+#include "CompressedTexture.hpp"
+#include "BC1Encoder.hpp"
+#include "CacheFile.hpp"
+#include "MappedFile.hpp"
+#include "Texture.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <string.h>
+
+using namespace glm;  // avoid glm:: for all glm types and functions
+
+CompressedTexture::CompressedTexture(const char *ppmPath) :
+    base(nullptr), size(0)
+{
+    std::filesystem::path source = std::filesystem::absolute(std::filesystem::u8path(ppmPath));
+    std::filesystem::path cachePath = cacheFileFor(source, ".bc1");
+    if (mapCache(cachePath.u8string().c_str(), source.u8string().c_str()))
+        return;
+
+    if (!build(source.u8string().c_str()))
+        return;
+
+    // save for next time
+    writeCacheFile(cachePath, image.data(), image.size());
+}
+
+CompressedTexture::~CompressedTexture()
+{
+}
+
+size_t CompressedTexture::levelBytes() const
+{
+    const Header &head = header();
+    return head.levelOffset[head.numLevels - 1] + head.levelSize[head.numLevels - 1] - head.levelOffset[0];
+}
+
+// map existing cache file, checking that it's complete and up to date
+bool CompressedTexture::mapCache(const char *cachePath, const char *ppmPath)
+{
+    std::unique_ptr<MappedFile> mapped(new MappedFile(cachePath));
+    if (!mapped->isOpen() || mapped->size < sizeof(Header)) return false;
+
+    const char *data = mapped->data;
+    size_t bytes = mapped->size;
+    const Header &head = *(const Header*)data;
+    if (memcmp(head.magic, "GLTX", 4) != 0 || head.version != VERSION) return false;
+    if (head.width == 0 || head.height == 0 || head.numLevels == 0 || head.numLevels > MAX_LEVELS)
+        return false;
+
+    // source unchanged?
+    if (head.sourcePathOffset >= bytes ||
+        !memchr(data + head.sourcePathOffset, 0, bytes - head.sourcePathOffset) ||
+        strcmp(data + head.sourcePathOffset, ppmPath) != 0)
+        return false;
+    uint64_t fileSize;
+    int64_t mtime;
+    fileStamp(std::filesystem::u8path(ppmPath), fileSize, mtime);
+    if (fileSize != head.sourceSize || mtime != head.sourceMtime) return false;
+
+    // every level the right size, contiguous, and in range?
+    int width = int(head.width), height = int(head.height);
+    for (uint32_t i = 0; i < head.numLevels; ++i) {
+        if (head.levelSize[i] != bc1Size(width, height) ||
+            head.levelOffset[i] > bytes || head.levelSize[i] > bytes - head.levelOffset[i] ||
+            (i > 0 && head.levelOffset[i] != head.levelOffset[i-1] + head.levelSize[i-1]))
+            return false;
+        width = std::max(width / 2, 1);
+        height = std::max(height / 2, 1);
+    }
+
+    file = std::move(mapped);
+    base = data;
+    size = bytes;
+    return true;
+}
+
+// compress every mip level of the source into image
+bool CompressedTexture::build(const char *ppmPath)
+{
+    int width, height;
+    MappedFile ppm(ppmPath);
+    const u8vec3 *pixels = Texture::parsePPM(ppm, ppmPath, width, height);
+    if (!pixels) return false;
+
+    Header head = {{'G','L','T','X'}, VERSION, uint32_t(width), uint32_t(height)};
+    fileStamp(std::filesystem::u8path(ppmPath), head.sourceSize, head.sourceMtime);
+    head.numLevels = 1;
+    while ((width >> head.numLevels) > 0 || (height >> head.numLevels) > 0) ++head.numLevels;
+
+    // header, path, then levels
+    size_t offset = sizeof(Header);
+    head.sourcePathOffset = offset;
+    offset += strlen(ppmPath) + 1;
+    offset = (offset + 15) & ~size_t(15);
+    for (uint32_t i = 0; i < head.numLevels; ++i) {
+        head.levelOffset[i] = offset;
+        head.levelSize[i] = bc1Size(std::max(width >> i, 1), std::max(height >> i, 1));
+        offset += head.levelSize[i];
+    }
+    image.assign(offset, 0);
+    memcpy(&image[0], &head, sizeof(head));
+    strcpy(&image[head.sourcePathOffset], ppmPath);
+
+    // level 0 straight from the file, walking rows bottom up for GL
+    const u8vec3 *level = pixels + size_t(height - 1) * width;
+    ptrdiff_t stride = -ptrdiff_t(width);
+    std::vector<u8vec3> mip[2];                 // ping-pong buffers for smaller levels
+    for (uint32_t i = 0; i < head.numLevels; ++i) {
+        int levelWidth = std::max(width >> i, 1), levelHeight = std::max(height >> i, 1);
+        encodeBC1(level, stride, levelWidth, levelHeight, (uint8_t*)&image[head.levelOffset[i]]);
+        if (i + 1 == head.numLevels) break;
+
+        std::vector<u8vec3> &next = mip[i & 1];
+        next.resize(size_t(std::max(levelWidth / 2, 1)) * std::max(levelHeight / 2, 1));
+        downsample(level, stride, levelWidth, levelHeight, next.data());
+        level = next.data();
+        stride = std::max(levelWidth / 2, 1);
+    }
+
+    base = image.data();
+    size = image.size();
+    return true;
+}
@@ -0,0 +1,59 @@
+// BC1 compressed copy of a PPM image with its full mipmap chain
+//
+// Built on first load and written to the cache directory. Later loads
+// map the file and hand the levels straight to glCompressedTexImage2D.
+#pragma once
+
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+class CompressedTexture {
+public:
+    // bump when the layout or encoder output changes
+    enum { VERSION = 1, MAX_LEVELS = 32 };
+
+    // file layout: Header, source path string, then mip levels, largest
+    // first, in one contiguous run
+    struct Header {
+        char magic[4];                  // "GLTX"
+        uint32_t version;               // VERSION
+        uint32_t width, height;         // size of level 0
+        uint32_t numLevels;             // down to 1x1
+        uint32_t pad;
+        uint64_t sourceSize;            // PPM file size in bytes
+        int64_t sourceMtime;            // PPM modification time, filesystem clock
+        uint64_t sourcePathOffset;      // PPM path string
+        uint64_t levelOffset[MAX_LEVELS];   // BC1 blocks for each level
+        uint64_t levelSize[MAX_LEVELS];
+    };
+
+private:
+    std::unique_ptr<class MappedFile> file;     // cache file, if mapped
+    std::vector<char> image;                    // cache in memory, if not
+    const char *base;                           // start of cache data
+    size_t size;                                // bytes of cache data
+
+public:
+    // find a current cache for ppmPath, building it if necessary
+    // check isValid() for success, safe to use from any thread
+    CompressedTexture(const char *ppmPath);
+    ~CompressedTexture();
+
+    bool isValid() const { return base != nullptr; }
+    bool isMapped() const { return file != nullptr; }  // loaded from cache file?
+
+    // cached contents
+    const Header &header() const { return *(const Header*)base; }
+    const uint8_t *level(unsigned int i) const { return (const uint8_t*)(base + header().levelOffset[i]); }
+
+    // total bytes of all levels
+    size_t levelBytes() const;
+
+private:
+    // map file and check it against the current source
+    bool mapCache(const char *cachePath, const char *ppmPath);
+
+    // compress source into image
+    bool build(const char *ppmPath);
+};
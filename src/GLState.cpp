@@ -0,0 +1,119 @@
+// GL binding state cache, skipping calls that would change nothing
+
+#include "GLState.hpp"
+
+#include <GL/glew.h>
+
+GLState::GLState() :
+    issued(0), elided(0)
+{
+    invalidate();
+}
+
+void GLState::invalidate()
+{
+    program = varray = activeUnit = polygonModeValue = UNKNOWN;
+    for (auto &unit : textures)
+        for (unsigned int &texture : unit)
+            texture = UNKNOWN;
+    for (unsigned int &buffer : buffers)
+        buffer = UNKNOWN;
+    for (Range &binding : uniformBindings)
+        binding = {UNKNOWN, 0, 0};
+}
+
+void GLState::beginFrame()
+{
+    invalidate();
+    issued = elided = 0;
+}
+
+bool GLState::change(unsigned int &current, unsigned int value)
+{
+    if (current == value) {
+        ++elided;
+        return false;
+    }
+    current = value;
+    ++issued;
+    return true;
+}
+
+void GLState::useProgram(unsigned int programID)
+{
+    if (change(program, programID))
+        glUseProgram(programID);
+}
+
+void GLState::bindVertexArray(unsigned int varrayID)
+{
+    if (change(varray, varrayID))
+        glBindVertexArray(varrayID);
+}
+
+void GLState::activeTexture(unsigned int unit)
+{
+    if (change(activeUnit, unit))
+        glActiveTexture(GL_TEXTURE0 + unit);
+}
+
+void GLState::bindTexture(unsigned int unit, unsigned int target, unsigned int textureID)
+{
+    int slot = target == GL_TEXTURE_2D ? TEXTURE_2D
+        : target == GL_TEXTURE_2D_ARRAY ? TEXTURE_2D_ARRAY : NUM_TARGETS;
+    if (unit < MAX_UNITS && slot < NUM_TARGETS && textures[unit][slot] == textureID) {
+        ++elided;
+        return;
+    }
+
+    activeTexture(unit);
+    if (unit < MAX_UNITS && slot < NUM_TARGETS) textures[unit][slot] = textureID;
+    glBindTexture(target, textureID);
+    ++issued;
+}
+
+void GLState::bindBuffer(unsigned int target, unsigned int bufferID)
+{
+    unsigned int untracked = UNKNOWN;
+    unsigned int &current = target == GL_ARRAY_BUFFER ? buffers[ARRAY_BUFFER]
+        : target == GL_UNIFORM_BUFFER ? buffers[UNIFORM_BUFFER] : untracked;
+    if (change(current, bufferID))
+        glBindBuffer(target, bufferID);
+}
+
+void GLState::bindBufferBase(unsigned int target, unsigned int index, unsigned int bufferID)
+{
+    bindBufferRange(target, index, bufferID, 0, 0);
+}
+
+void GLState::bindBufferRange(unsigned int target, unsigned int index, unsigned int bufferID,
+    size_t offset, size_t size)
+{
+    bool tracked = target == GL_UNIFORM_BUFFER && index < MAX_UNIFORM_BINDINGS;
+    if (tracked) {
+        Range &current = uniformBindings[index];
+        if (current.buffer == bufferID && current.offset == offset && current.size == size) {
+            ++elided;
+            return;
+        }
+        current = {bufferID, offset, size};
+    }
+
+    // also binds the generic target
+    if (size) glBindBufferRange(target, index, bufferID, GLintptr(offset), GLsizeiptr(size));
+    else glBindBufferBase(target, index, bufferID);
+    if (target == GL_UNIFORM_BUFFER) buffers[UNIFORM_BUFFER] = bufferID;
+    ++issued;
+}
+
+void GLState::polygonMode(unsigned int mode)
+{
+    if (change(polygonModeValue, mode))
+        glPolygonMode(GL_FRONT_AND_BACK, mode);
+}
+
+GLState &GLState::shared()
+{
+    static GLState state;
+    return state;
+}
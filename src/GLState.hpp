@@ -0,0 +1,68 @@
+// GL binding state cache, skipping calls that would change nothing
+//
+// Tracks what this code last bound, rather than querying GL. Programs,
+// vertex arrays and array & uniform buffers are always bound through it.
+// Texture loading still binds textures and units directly, so that code
+// must call invalidate() before the next tracked call, so nothing is
+// wrongly skipped.
+#pragma once
+
+#include <stddef.h>
+
+class GLState {
+public:
+    // tracked texture units and indexed uniform buffer bindings
+    enum { MAX_UNITS = 16, MAX_UNIFORM_BINDINGS = 16 };
+
+private:
+    enum : unsigned int { UNKNOWN = ~0u };
+
+    // texture targets tracked per unit
+    enum { TEXTURE_2D, TEXTURE_2D_ARRAY, NUM_TARGETS };
+
+    // buffer targets tracked, others are always issued
+    enum { ARRAY_BUFFER, UNIFORM_BUFFER, NUM_BUFFER_TARGETS };
+
+    unsigned int program;                               // glUseProgram
+    unsigned int varray;                                // glBindVertexArray
+    unsigned int activeUnit;                            // glActiveTexture, as unit number
+    unsigned int textures[MAX_UNITS][NUM_TARGETS];      // glBindTexture per unit
+    unsigned int buffers[NUM_BUFFER_TARGETS];           // glBindBuffer
+    struct Range {
+        unsigned int buffer;
+        size_t offset, size;                            // size 0 for whole buffer
+    } uniformBindings[MAX_UNIFORM_BINDINGS];            // glBindBufferBase/Range
+    unsigned int polygonModeValue;                      // glPolygonMode, front & back
+
+public:
+    // statistics since the last beginFrame()
+    unsigned int issued;        // calls passed on to GL
+    unsigned int elided;        // calls skipped as already current
+
+public:
+    GLState();
+
+    // forget all tracked state, for after direct GL binds
+    void invalidate();
+
+    // invalidate and reset statistics
+    void beginFrame();
+
+    // tracked equivalents of the GL calls
+    void useProgram(unsigned int programID);
+    void bindVertexArray(unsigned int varrayID);
+    void activeTexture(unsigned int unit);              // unit number, not GL_TEXTURE0 + unit
+    void bindTexture(unsigned int unit, unsigned int target, unsigned int textureID);
+    void bindBuffer(unsigned int target, unsigned int bufferID);
+    void bindBufferBase(unsigned int target, unsigned int index, unsigned int bufferID);
+    void bindBufferRange(unsigned int target, unsigned int index, unsigned int bufferID,
+        size_t offset, size_t size);
+    void polygonMode(unsigned int mode);                // for GL_FRONT_AND_BACK
+
+    // state tracker for the GL context, must be used from the GL thread
+    static GLState &shared();
+
+private:
+    // count a call, returning true if it should be issued
+    bool change(unsigned int &current, unsigned int value);
+};
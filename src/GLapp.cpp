@@ -4,9 +4,19 @@
 
 
 #include "GLapp.hpp"
+#include "GLState.hpp"
 #include "Sphere.hpp"
 #include "Plane.hpp"
 #include "Triangle.hpp"
+#include "MeshCache.hpp"
+#include "LoadBenchmark.hpp"
+#include "MemoryStats.hpp"
+#include "RayBenchmark.hpp"
+#include "ShaderCache.hpp"
+#include "TextureCache.hpp"
+#include "TextureResidency.hpp"
+#include "ThreadPool.hpp"
+#include "config.h"
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <GL/glew.h>
@@ -18,6 +28,8 @@
 #include <string>
 #include <cstring>
 #include <fstream>
+#include <filesystem>
+#include <memory>
 #include <vector>
 #include <map>
 #include <iostream>
@@ -93,9 +105,8 @@ extern "C" {
                 app->xRate = -500.0f * F_PI; // 1/4 rotation/sec
                 return;
 
-            case 'R':                   // reload shaders
-                for (auto object : app->objects)
-                    object->updateShaders();
+            case 'R':                   // reload shaders, once per program
+                ShaderCache::shared().reload();
                 return;
 
             case 'I':                   // cycle through ambient intensity
@@ -106,7 +117,7 @@ extern "C" {
 
             case 'L':                   // toggle lines or solid
                 app->wireframe = !app->wireframe;
-                glPolygonMode(GL_FRONT_AND_BACK, app->wireframe ? GL_LINE : GL_FILL);
+                GLState::shared().polygonMode(app->wireframe ? GL_LINE : GL_FILL);
                 return;
 
             case GLFW_KEY_ESCAPE:                    // Escape
@@ -199,9 +210,13 @@ GLapp::GLapp()
 
     // initialize buffer for scene shader data
     glGenBuffers(1, &sceneUniformsID);
-    glBindBuffer(GL_UNIFORM_BUFFER, sceneUniformsID);
+    GLState::shared().bindBuffer(GL_UNIFORM_BUFFER, sceneUniformsID);
     glBufferData(GL_UNIFORM_BUFFER, sizeof(SceneShaderData), 0, GL_STREAM_DRAW);
 
+    // material buffer starts with just the default material
+    glGenBuffers(1, &materialUniformsID);
+    materials.upload(materialUniformsID);
+
     // initialize scene data
     sceneShaderData.LightDir = vec4(-1,-2,2,0);
 }
@@ -210,12 +225,30 @@ GLapp::GLapp()
 // Clean up any context data
 GLapp::~GLapp() 
 {
+    // finish texture decodes while the cache they report to still exists
+    ThreadPool::shared().shutdown();
+
     for (auto obj: objects)
         delete obj;
+    TextureCache::shared().release();
+    queue.uniforms.release();
+    queue.batch.release();
     glfwDestroyWindow(win);
     glfwTerminate();
 }
 
+// one BVH over every static object, moving objects are not collided with
+void GLapp::buildCollision()
+{
+    std::vector<vec3> corners;
+    for (Object *object : objects)
+        if (object->isStatic())
+            object->collisionTriangles(corners);
+    collision.build(corners);
+    printf("collision: %zu triangles in %zu BVH nodes, depth %u, built in %.2f ms\n",
+        collision.numTriangles, collision.nodes.size(), collision.depth, 1000 * collision.buildTime);
+}
+
 // call before drawing each frame to update per-frame scene state
 void GLapp::sceneUpdate(double dTime)
 {
@@ -236,39 +269,43 @@ void GLapp::sceneUpdate(double dTime)
     tilt = min(tilt, 1.5f);
     tilt = max(tilt, -1.5f);
 
-    // Ray Attributes For Intercept
-    vec3 rayStart = pos;
-    vec3 rayDir(pos[0] + cosf(((pan / turn) * 360) * F_PI / 180), 
-        pos[1] + sinf(((pan / turn) * 360) * F_PI / 180), pos[2]);
-    vec3 zDir = normalize(vec3(pos[0], pos[1], pos[2] - 1));
-    
-    float tXY = 300, tZ = 500;
-
-    for (auto object : objects) {
-
-        // Find Closest Intersection
-        tXY = (tXY > object->intersect(rayStart, rayDir, 0)) ?
-            object->intersect(rayStart, rayDir, 0) : tXY;
-
-        // Find Intersection Between 250 And 750 Units
-        tZ = (object->intersect(rayStart, zDir, 250) >= 250 &&
-            object->intersect(rayStart, zDir, 250) <= 750) ?
-            object->intersect(rayStart, zDir, 250) : tZ;
+    // Movement For WASD
+    float heading = ((pan / turn) * 360) * F_PI / 180;
+    vec3 move(float(xRate * dTime) * cosf(heading) + float(yRate * dTime) * sinf(heading),
+              float(yRate * dTime) * cosf(heading) - float(xRate * dTime) * sinf(heading),
+              0);
+
+    // camera is a sphere of wall distance radius, and floats eye height above the floor
+    // floor is searched for between floorNear and floorFar below the eye
+    // skin keeps it from resting exactly on the wall it slid along
+    // each slide is swept again, up to maxSweeps in all, so a corner stops it too
+    const float wallDistance = 250, eyeHeight = 500, skin = 1;
+    const float floorNear = 250, floorFar = 750;
+    const int maxSweeps = 3;
+
+    // Stop At The First Wall Touched Along The Way, Sliding Along It For The Rest
+    // any slide left after the last sweep is dropped
+    vec3 moved(0);
+    for (int sweep = 0; sweep < maxSweeps && move != vec3(0); ++sweep) {
+        BVH::Contact contact;
+        if (!collision.sweep(pos + moved, wallDistance, move, contact)) {
+            moved += move;
+            break;
+        }
+        moved += move * contact.t + contact.normal * skin;
+        move = contact.slide;
     }
 
-    // Stop Forward Movement, If Wall Is Close
-    if (tXY <= 250 && xRate > 0) {
-        xRate = 0;
-    }
+    // Closest Floor Below
+    BVH::Hit ground;
+    float tZ = collision.closest(pos, vec3(0, 0, -1), floorNear, floorFar, ground)
+        ? ground.t : eyeHeight;
 
     // Adjust Z Height
-    camPos[2] += 500 - tZ;
+    camPos[2] += eyeHeight - tZ;
 
-    // Movement For WASD
-    camPos[0] += float(xRate * dTime) * cosf(((pan / turn) * 360) * F_PI / 180) 
-        + float(yRate * dTime) * sinf(((pan / turn) * 360) * F_PI / 180);
-    camPos[1] += float(yRate * dTime) * cosf(((pan / turn) * 360) * F_PI / 180) 
-        - float(xRate * dTime) * sinf(((pan / turn) * 360) * F_PI / 180);
+    camPos[0] += moved[0];
+    camPos[1] += moved[1];
     
     sceneShaderData.ProjFromWorld = 
         perspective(F_PI / 4.f, (float)width / height, near, far)
@@ -277,7 +314,7 @@ void GLapp::sceneUpdate(double dTime)
         * translate(eyePos, vec3(0,0,0));
     sceneShaderData.WorldFromProj = inverse(sceneShaderData.ProjFromWorld);
 
-    glBindBuffer(GL_UNIFORM_BUFFER, sceneUniformsID);
+    GLState::shared().bindBuffer(GL_UNIFORM_BUFFER, sceneUniformsID);
     glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(SceneShaderData), &sceneShaderData);
 
 }
@@ -293,10 +330,15 @@ void GLapp::render()
     glClearColor(0.5, 0.7, 0.9, 1.f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    // draw all objects
+    // swap in any textures that finished loading, drop unused ones
+    // to low resolution if over budget, and bind texture arrays
+    TextureCache::shared().update();
+    TextureResidency::shared().update();
+    TextureCache::shared().bindArrays();
+
+    // draw all objects, sorted by state
     sceneUpdate(dTime);
-    for (auto object : objects)
-        object->draw(this, currTime);
+    queue.draw(this, currTime);
 
     // show what we drew
     glfwSwapBuffers(win);
@@ -309,238 +351,86 @@ int main(int argc, char *argv[])
     GLapp app;
 
     for (int i = 1; i < argc; i++) {
-        std::ifstream ifile;
-        std::ifstream mtlFile;
-        std::string fileName, token, mtlToken, lib, mtl, filePath = "../data/castle/";
-        std::vector<vec3> vVert, vnVert, vnDraw;
-        std::vector<vec2> vtVert, vtDraw;
         vec2 viewDist(1000.0f, 0.0f);
-        std::vector<unsigned int> fVert, vtIndex, vnIndex;
-        std::map<std::string, vec3> ka;
-        vec3* currKa = &ka[""];
-        std::map<std::string, vec3> kd;
-        vec3* currKd = &kd[""];
-        std::map<std::string, vec3> ks;
-        vec3* currKs = &ks[""];
-        std::map<std::string, float> ns;
-        float* currNs = &ns[""];
-        std::map<std::string, std::string> mtlName;
-        std::string* currMtl = &mtlName[""];
-
-        ifile.open(filePath + "castle.obj");
-
-        // File Parsing
-        if (ifile.is_open()) {
-            ifile >> token;
-            while (!ifile.eof()) {
-
-                // Open mtl file and retrieve texture data
-                if (token == "mtllib") {
-                    ifile >> lib;
-                    mtlFile.open(filePath + lib);
-                    if (mtlFile.is_open()) {
-                        mtlFile >> mtlToken;
-                        while (!mtlFile.eof()) {
-
-                            // Map texture data to mtl label
-                            if (mtlToken == "newmtl") {
-                                mtlFile >> mtl;
-                                currKa = &ka[mtl];
-                                currKd = &kd[mtl];
-                                currKs = &ks[mtl];
-                                currNs = &ns[mtl];
-                                currMtl = &mtlName[mtl];
-                            }
-                            else if (mtlToken == "Ka")
-                                mtlFile >> (*currKa)[0] >> (*currKa)[1] >> (*currKa)[2];
-                            else if (mtlToken == "Kd")
-                                mtlFile >> (*currKd)[0] >> (*currKd)[1] >> (*currKd)[2];
-                            else if (mtlToken == "Ks")
-                                mtlFile >> (*currKs)[0] >> (*currKs)[1] >> (*currKs)[2];
-                            else if (mtlToken == "Ns")
-                                mtlFile >> *currNs;
-                            else if (mtlToken == "map_Kd") {
-                                mtlFile >> mtlToken;
-                                *currMtl = filePath + mtlToken;
-                            }
-                            mtlFile >> mtlToken;
-                        }
-                    }
-                }
-
-                else if (token == "usemtl") {
-
-                    // Initialize vnDraw and vtDraw for object creation
-                    if (vnDraw.size() < vVert.size()) {
-                        while (vnDraw.size() != vVert.size()) {
-                            vnDraw.push_back(vec3(0, 0, 0));
-                        }
-                    }
-                    if (vtDraw.size() < vVert.size()) {
-                        while (vtDraw.size() != vVert.size()) {
-                            vtDraw.push_back(vec2(0, 0));
-                        }
-                    }
-
-                    // Check if end of mtl instance
-                    if (fVert.size() > 0) {
-
-                        // Match texture coords and normals to vertex positions
-                        for (int i = 0; i < fVert.size(); i++) {
-                            vnDraw[fVert[i]] = vnVert[vnIndex[i]];
-                            vtDraw[fVert[i]] = vtVert[vtIndex[i]];
-                        }
-
-                        // Pass in object data and create object
-                        const char* mtlPPM = mtlName[mtl].c_str();
-                        app.objects.push_back(new Plane(vVert, vnDraw, vtDraw, fVert, mtlPPM));
-
-                        // Empty object arrays to prepare for new object
-                        fVert = {};
-                        vnIndex = {};
-                        vtIndex = {};
-                    }
-                    ifile >> mtl;
-                }
 
-                else if (token == "v") { // v
-                    float a, b, c;
-                    ifile >> token; a = std::stof(token);
-                    ifile >> token; b = std::stof(token);
-                    ifile >> token; c = std::stof(token);
-                    vec3* vert3 = new vec3(a, b, c);
-                    vVert.push_back(*vert3);
-
-                    // View Handeling
-                    vec3 distVec(a, b, c);
-                    for (int i = 0; i < 3; i++) {
-
-                        // Check for lower bound of view
-                        if (distVec[i] < viewDist[0]) {
-                            viewDist[0] = distVec[i];
-                            if (viewDist[1] != 0) {
-                                app.distance = 2 * viewDist[1] - viewDist[0];
-                                app.far = viewDist[1] + app.distance;
-                                app.near = (viewDist[0] < 0) ? 2 * viewDist[0] + app.distance : app.distance - 2 * viewDist[0];
-                            }
-                        }
-
-                        // Check for upper bound of view
-                        if (distVec[i] > viewDist[1]) {
-                            viewDist[1] = distVec[i];
-                            if (viewDist[0] != 1000) {
-                                app.distance = 2 * viewDist[1] - viewDist[0];
-                                app.far = viewDist[1] + app.distance;
-                                app.near = (viewDist[0] < 0) ? 2 * viewDist[0] + app.distance : app.distance - 2 * viewDist[0];
-                            }
-                        }
-                    }
-                }
-                else if (token == "vt") { // uv
-                    float a, b;
-                    ifile >> token; a = std::stof(token);
-                    ifile >> token; b = std::stof(token);
-                    vec2* vert2 = new vec2(a, b);
-                    vtVert.push_back(*vert2);
-                }
-                else if (token == "vn") { // norm
-                    float a, b, c;
-                    ifile >> token; a = std::stof(token);
-                    ifile >> token; b = std::stof(token);
-                    ifile >> token; c = std::stof(token);
-                    vec3* vertNorm = new vec3(a, b, c);
-                    vnVert.push_back(*vertNorm);
-                }
-                else if (token == "f") { // indices
-                    for (int j = 0; j < 3; j++) {
-                        ifile >> token;
-                        unsigned int face = 0;
-
-                        // Separate polygon face data into arrays
-                        for (int i = 0; i < token.length(); i++) {
-
-                            // Separate digits of f
-                            if (token[i] != '/') {
-                                if (face == 0)
-                                    face = atof(&token[i]);
-                            }
-                            else {
-
-                                // Check which array to fill
-                                if (vtIndex.size() < fVert.size()) {
-
-                                    // Input texture data
-                                    vtIndex.push_back(face - 1);
-                                    face = 0;
-                                }
-                                else if (vnIndex.size() < fVert.size()) {
-
-                                    // Input normal data
-                                    vnIndex.push_back(face - 1);
-                                    face = 0;
-                                }
-                                else {
-
-                                    // Input vertex position data
-                                    fVert.push_back(face - 1);
-                                    face = 0;
-                                }
-                            }
-                            if (i == (token.length() - 1)) {
-
-                                // Check which array to fill
-                                if (vtIndex.size() < fVert.size()) {
-
-                                    // Input texture data
-                                    vtIndex.push_back(face - 1);
-                                    face = 0;
-                                }
-                                else if (vnIndex.size() < fVert.size()) {
-
-                                    // Input normal data
-                                    vnIndex.push_back(face - 1);
-                                    face = 0;
-                                }
-                                else {
-
-                                    // Input vertex position data
-                                    fVert.push_back(face - 1);
-                                    face = 0;
-                                }
-                            }
-                        }
-                    }
-                }
-                ifile >> token;
-            }
+        // find .obj file, trying relative paths in the data directory too
+        std::filesystem::path objPath(argv[i]);
+        if (objPath.is_relative() && !std::filesystem::exists(objPath))
+            objPath = std::filesystem::path(PROJECT_DATA_DIR) / objPath;
 
-            // Initialize vnDraw and vtDraw for object creation
-            if (vnDraw.size() < vVert.size()) {
-                while (vnDraw.size() != vVert.size()) {
-                    vnDraw.push_back(vec3(0, 0, 0));
-                }
-            }
-            if (vtDraw.size() < vVert.size()) {
-                while (vtDraw.size() != vVert.size()) {
-                    vtDraw.push_back(vec2(0, 0));
-                }
-            }
+#ifdef GLAPP_LOAD_BENCHMARK
+        loadBenchmark(objPath.filename().string().c_str(), objPath.u8string().c_str());
+#endif
 
-            // Check if object data is present
-            if (fVert.size() > 0) {
+        // load from mesh cache, parsing .obj and .mtl only if it is out of date
+        double loadStart = glfwGetTime();
+        std::shared_ptr<MeshCache> cache;
+        {
+            MemoryStats::Scope stats("model load");
+            cache = std::make_shared<MeshCache>(objPath.u8string().c_str());
+        }
+        if (!cache->isValid()) continue;
+        const MeshCache::Header &header = cache->header();
+        printf("%s: %u materials %s in %.2f ms\n",
+            objPath.filename().string().c_str(), header.numGroups,
+            cache->isMapped() ? "mapped from cache" : "parsed", 1000 * (glfwGetTime() - loadStart));
+
+        // View Handeling: widen view to cover the model bounds
+        viewDist[0] = min(viewDist[0], min(header.lo.x, min(header.lo.y, header.lo.z)));
+        viewDist[1] = max(viewDist[1], max(header.hi.x, max(header.hi.y, header.hi.z)));
+        if (viewDist[0] != 1000 && viewDist[1] != 0) {
+            app.distance = 2 * viewDist[1] - viewDist[0];
+            app.far = viewDist[1] + app.distance;
+            app.near = (viewDist[0] < 0) ? 2 * viewDist[0] + app.distance : app.distance - 2 * viewDist[0];
+        }
 
-                // Match texture coords and normals to vertex positions
-                for (int i = 0; i < fVert.size(); i++) {
-                    vnDraw[fVert[i]] = vnVert[vnIndex[i]];
-                    vtDraw[fVert[i]] = vtVert[vtIndex[i]];
-                }
+        // one GPU copy of the model, shared by all of its objects
+        auto mesh = std::make_shared<MeshBuffer>(header.numVerts,
+            cache->array<vec3>(header.vertOffset), cache->array<vec3>(header.normOffset),
+            cache->array<vec2>(header.uvOffset), header.numIndices,
+            cache->array<unsigned int>(header.indexOffset));
+        printf("%s: %.2f MB of vertex and index data on GPU for %u objects\n",
+            objPath.filename().string().c_str(), mesh->memory() / 1048576., header.numGroups);
+
+        // add model materials to the scene table, names qualified by model
+        // once the table is full, the rest draw with the default material
+        std::vector<unsigned int> materialIDs(header.numMaterials, MaterialLibrary::DEFAULT);
+        unsigned int dropped = 0;
+        for (uint32_t m = 1; m < header.numMaterials; ++m) {
+            const MeshCache::Material &material = cache->materials()[m];
+            std::string name = objPath.u8string() + ":" + cache->string(material.nameOffset);
+            if (app.materials.full() && app.materials.find(name) == MaterialLibrary::NOT_FOUND) {
+                ++dropped;
+                continue;
             }
-
-            // Pass in object data and create object
-            const char* mtlPPM = mtlName[mtl].c_str();
-            app.objects.push_back(new Plane(vVert, vnDraw, vtDraw, fVert, mtlPPM));
+            unsigned int id = app.materials.define(name);
+            app.materials.Ka[id] = material.Ka;
+            app.materials.Kd[id] = material.Kd;
+            app.materials.Ks[id] = material.Ks;
+            app.materials.Ns[id] = material.Ns;
+            app.materials.textures[id] = cache->string(material.textureOffset);
+            materialIDs[m] = id;
+        }
+        if (dropped)
+            fprintf(stderr, "%s: %u materials past the %d the shaders hold, drawn with the default material\n",
+                objPath.filename().string().c_str(), dropped, int(MaterialLibrary::MAX_MATERIALS));
+
+        // Pass in object data and create one object per mtl instance
+        for (uint32_t g = 0; g < header.numGroups; g++) {
+            const MeshCache::Group &group = cache->groups()[g];
+            app.objects.push_back(new Plane(cache, mesh, group, materialIDs[group.material]));
         }
+
+#ifdef GLAPP_RAY_BENCHMARK
+        // this model's objects, alone
+        std::vector<Object*> modelObjects(app.objects.end() - header.numGroups, app.objects.end());
+        rayBenchmark(objPath.filename().string().c_str(), modelObjects);
+#endif
     }
+    app.buildCollision();
+
+    // one upload for all materials
+    app.materials.upload(app.materialUniformsID);
 
     // set up initial viewport
     reshape(app.win, app.width, app.height);
@@ -550,8 +440,20 @@ int main(int argc, char *argv[])
     app.camPos = {-10000, -1150, 500};
 
     // each frame: render then check for events
+    // GLFW time starts at initialization, so the first frame shows startup cost
+    bool firstFrame = true;
     while (!glfwWindowShouldClose(app.win)) {
         app.render();
+        if (firstFrame) {
+            // shader variants are loaded as objects first draw
+            glFinish();
+            const ShaderCache &shaders = ShaderCache::shared();
+            printf("%zu objects share %u shader programs, %u from binary cache, %u failed, loaded in %.2f ms\n",
+                app.objects.size(), shaders.compiles + shaders.binaries, shaders.binaries,
+                shaders.failures, 1000 * shaders.loadTime);
+            printf("first frame drawn %.2f ms after startup\n", 1000 * glfwGetTime());
+            firstFrame = false;
+        }
         glfwPollEvents();
     }
 
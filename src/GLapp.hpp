@@ -2,6 +2,9 @@
 // 
 #pragma once
 
+#include "BVH.hpp"
+#include "MaterialLibrary.hpp"
+#include "RenderQueue.hpp"
 #include <glm/glm.hpp>
 #include <vector>
 
@@ -18,6 +21,10 @@ public:
     } sceneShaderData;
     unsigned int sceneUniformsID;
 
+    // materials of all loaded models, uploaded once after loading
+    MaterialLibrary materials;
+    unsigned int materialUniformsID;
+
     // view info
     bool active;                // clicked into window
     int width, height;          // current window dimensions
@@ -39,14 +46,21 @@ public:
     std::vector<float> camPos;
     glm::mat4 eyePos;
 
-    // objects to draw
+    // objects to draw, and the queue sorting them by GL state
     std::vector<class Object*> objects;
+    RenderQueue queue;
+
+    // static object triangles, for camera collision
+    BVH collision;
 
 public:
     // initialize and destroy app data
     GLapp();
     ~GLapp();
 
+    // build collision from all static objects, once they are loaded
+    void buildCollision();
+
     // update shader uniform state each frame
     void sceneUpdate(double dTime);
 
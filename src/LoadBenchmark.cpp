@@ -0,0 +1,134 @@
+// .obj parse timing on a model as it loads, run when built with GLAPP_LOAD_BENCHMARK
+
+#include "LoadBenchmark.hpp"
+#include "ObjLoader.hpp"
+
+#include <GLFW/glfw3.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace glm;  // avoid glm:: for all glm types and functions
+
+// best of this many parses with each loader
+enum { RUNS = 5 };
+
+// parsed attributes and corner count, to compare the loaders
+struct StreamData {
+    std::vector<vec3> vVert, vnVert;
+    std::vector<vec2> vtVert;
+    std::vector<unsigned int> fVert;
+};
+
+// the ifstream >> token & std::stof loop main() used before loadObj()
+// kept as it was apart from its per-vertex heap leaks, which would only add to its time
+// like the original, reads three corners per face & ignores '#' comments
+static bool streamParse(const char *path, StreamData &data)
+{
+    std::ifstream ifile(path);
+    if (!ifile.is_open()) return false;
+
+    std::string token, name;
+    std::vector<unsigned int> vtIndex, vnIndex;
+    ifile >> token;
+    while (!ifile.eof()) {
+        if (token == "mtllib" || token == "usemtl")
+            ifile >> name;
+        else if (token == "v") {
+            float a, b, c;
+            ifile >> token; a = std::stof(token);
+            ifile >> token; b = std::stof(token);
+            ifile >> token; c = std::stof(token);
+            data.vVert.push_back(vec3(a, b, c));
+        }
+        else if (token == "vt") {
+            float a, b;
+            ifile >> token; a = std::stof(token);
+            ifile >> token; b = std::stof(token);
+            data.vtVert.push_back(vec2(a, b));
+        }
+        else if (token == "vn") {
+            float a, b, c;
+            ifile >> token; a = std::stof(token);
+            ifile >> token; b = std::stof(token);
+            ifile >> token; c = std::stof(token);
+            data.vnVert.push_back(vec3(a, b, c));
+        }
+        else if (token == "f") {
+            for (int j = 0; j < 3; j++) {
+                ifile >> token;
+                unsigned int face = 0;
+
+                // digits of each v/vt/vn index, filling the array that is short
+                auto fill = [&] {
+                    if (vtIndex.size() < data.fVert.size())
+                        vtIndex.push_back(face - 1);
+                    else if (vnIndex.size() < data.fVert.size())
+                        vnIndex.push_back(face - 1);
+                    else
+                        data.fVert.push_back(face - 1);
+                    face = 0;
+                };
+                for (size_t i = 0; i < token.length(); i++) {
+                    if (token[i] != '/') {
+                        if (face == 0)
+                            face = unsigned(atof(&token[i]));
+                    }
+                    else
+                        fill();
+                    if (i == token.length() - 1)
+                        fill();
+                }
+            }
+        }
+        ifile >> token;
+    }
+    return true;
+}
+
+// number of entries differing between two attribute arrays, or all of them if the sizes differ
+template <typename A, typename B>
+static size_t countDiffer(const A &a, const B &b)
+{
+    if (a.size() != b.size()) return std::max(a.size(), b.size());
+    size_t differ = 0;
+    for (size_t i = 0; i < a.size(); ++i)
+        if (memcmp(&a[i], &b[i], sizeof(a[i])) != 0)
+            ++differ;
+    return differ;
+}
+
+void loadBenchmark(const char *name, const char *path)
+{
+    double streamTime = INFINITY, mappedTime = INFINITY;
+    size_t attributes = 0, differ = 0;
+    for (int run = 0; run < RUNS; ++run) {
+        StreamData stream;
+        double streamStart = glfwGetTime();
+        if (!streamParse(path, stream)) return;
+        streamTime = fmin(streamTime, glfwGetTime() - streamStart);
+
+        Arena arena;
+        ObjData obj(arena);
+        double mappedStart = glfwGetTime();
+        if (!loadObj(path, obj)) return;
+        mappedTime = fmin(mappedTime, glfwGetTime() - mappedStart);
+
+        // positions, normals and uvs have to come out bit for bit the same
+        attributes = stream.vVert.size() + stream.vtVert.size() + stream.vnVert.size();
+        differ = countDiffer(stream.vVert, obj.vVert)
+            + countDiffer(stream.vtVert, obj.vtVert) + countDiffer(stream.vnVert, obj.vnVert);
+    }
+
+    printf("%s: parse %.2f ms with stream loop, %.2f ms with loadObj (%.1fx), "
+        "%zu v/vt/vn attributes, %zu differ\n",
+        name, 1000 * streamTime, 1000 * mappedTime, streamTime / mappedTime,
+        attributes, differ);
+}
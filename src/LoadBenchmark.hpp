@@ -0,0 +1,6 @@
+// .obj parse timing on a model as it loads, run when built with GLAPP_LOAD_BENCHMARK
+#pragma once
+
+// time the stream parse main() used to do against loadObj() on the same file
+// and print the cost of each, reporting attributes where the two disagree
+void loadBenchmark(const char *name, const char *path);
@@ -0,0 +1,79 @@
+// read-only memory mapping of an entire file
+
+#include "MappedFile.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// empty files can't be mapped, but should still look open
+static const char emptyFile[1] = {0};
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const char *path) :
+    data(nullptr), size(0), fileHandle(INVALID_HANDLE_VALUE), mapHandle(nullptr)
+{
+    fileHandle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE) return;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(fileHandle, &fileSize)) return;
+    size = size_t(fileSize.QuadPart);
+    if (size == 0) {
+        data = emptyFile;
+        return;
+    }
+
+    mapHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapHandle) return;
+    data = (const char*)MapViewOfFile(mapHandle, FILE_MAP_READ, 0, 0, 0);
+}
+
+MappedFile::~MappedFile()
+{
+    if (data && data != emptyFile) UnmapViewOfFile(data);
+    if (mapHandle) CloseHandle(mapHandle);
+    if (fileHandle != INVALID_HANDLE_VALUE) CloseHandle(fileHandle);
+}
+
+#else
+
+MappedFile::MappedFile(const char *path) :
+    data(nullptr), size(0)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return;
+
+    struct stat statbuf;
+    if (fstat(fd, &statbuf) == 0) {
+        size = size_t(statbuf.st_size);
+        if (size == 0)
+            data = emptyFile;
+        else {
+            void *map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map != MAP_FAILED) {
+                // we always read front to back
+                madvise(map, size, MADV_SEQUENTIAL);
+                data = (const char*)map;
+            }
+        }
+    }
+
+    // mapping stays valid after the descriptor is closed
+    close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    if (data && data != emptyFile) munmap((void*)data, size);
+}
+
+#endif
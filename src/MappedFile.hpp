@@ -0,0 +1,29 @@
+// read-only memory mapping of an entire file
+#pragma once
+
+#include <stddef.h>
+
+class MappedFile {
+public:
+    const char *data;           // file contents, nullptr if the open failed
+    size_t size;                // file size in bytes
+
+private:
+#ifdef _WIN32
+    void *fileHandle, *mapHandle;   // Win32 HANDLEs for file and mapping
+#endif
+
+public:
+    // map the named file, check isOpen() for success
+    MappedFile(const char *path);
+
+    // unmap and close
+    ~MappedFile();
+
+    // mapping owns OS handles, so no copies
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool isOpen() const { return data != nullptr; }
+    const char *end() const { return data + size; }
+};
@@ -0,0 +1,54 @@
+// table of materials referenced by integer ID
+
+#include "MaterialLibrary.hpp"
+#include "GLState.hpp"
+
+#include <GL/glew.h>
+
+#include <assert.h>
+
+using namespace glm;  // avoid glm:: for all glm types and functions
+
+MaterialLibrary::MaterialLibrary()
+{
+    define("");
+}
+
+unsigned int MaterialLibrary::define(const std::string &name)
+{
+    auto inserted = ids.emplace(name, size());
+    if (!inserted.second) return inserted.first->second;
+
+    // same defaults as Object: white ambient and diffuse, no specular
+    names.push_back(name);
+    Ka.push_back(vec3(1));
+    Kd.push_back(vec3(1));
+    Ks.push_back(vec3(0));
+    Ns.push_back(0.f);
+    textures.push_back("");
+    return inserted.first->second;
+}
+
+unsigned int MaterialLibrary::find(const std::string &name) const
+{
+    auto found = ids.find(name);
+    return found == ids.end() ? NOT_FOUND : found->second;
+}
+
+void MaterialLibrary::upload(unsigned int bufferID) const
+{
+    assert(size() <= MAX_MATERIALS);
+
+    // std140 arrays of vec4, in MaterialData order
+    // specular exponent rides in the specular w
+    std::vector<vec4> data(3 * MAX_MATERIALS, vec4(0));
+    vec4 *ambient = &data[0], *diffuse = &data[MAX_MATERIALS], *specular = &data[2 * MAX_MATERIALS];
+    for (unsigned int i = 0; i < size(); ++i) {
+        ambient[i] = vec4(Ka[i], 0);
+        diffuse[i] = vec4(Kd[i], 0);
+        specular[i] = vec4(Ks[i], Ns[i]);
+    }
+
+    GLState::shared().bindBuffer(GL_UNIFORM_BUFFER, bufferID);
+    glBufferData(GL_UNIFORM_BUFFER, data.size() * sizeof(vec4), data.data(), GL_STATIC_DRAW);
+}
@@ -0,0 +1,48 @@
+// table of materials referenced by integer ID
+//
+// Names are interned once, so lookups after definition are a single hash.
+// Properties are kept in parallel arrays indexed by ID, the same layout
+// as the MaterialData uniform block they are uploaded to.
+#pragma once
+
+#include <glm/glm.hpp>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class MaterialLibrary {
+public:
+    // DEFAULT is always present: white ambient and diffuse, no specular
+    enum : unsigned int { DEFAULT = 0, NOT_FOUND = ~0u };
+
+    // array size in the MaterialData uniform block, must match shaders
+    enum { MAX_MATERIALS = 256 };
+
+    // per-material properties, indexed by ID
+    std::vector<std::string> names;     // interned material name
+    std::vector<glm::vec3> Ka, Kd, Ks;  // ambient, diffuse & specular color
+    std::vector<float> Ns;              // specular exponent
+    std::vector<std::string> textures;  // color texture path, "" for none
+
+private:
+    std::unordered_map<std::string, unsigned int> ids;   // name to ID
+
+public:
+    MaterialLibrary();
+
+    // ID for name, adding a material with default properties if new
+    unsigned int define(const std::string &name);
+
+    // ID for an existing name, or NOT_FOUND
+    unsigned int find(const std::string &name) const;
+
+    // number of materials, including DEFAULT
+    unsigned int size() const { return unsigned(names.size()); }
+
+    // true if another material would not fit in the MaterialData block
+    bool full() const { return size() >= MAX_MATERIALS; }
+
+    // load all materials into a uniform buffer for the MaterialData block
+    // callers stop defining materials once full(), so every ID is in the block
+    void upload(unsigned int bufferID) const;
+};
@@ -0,0 +1,79 @@
+// heap allocation and peak memory instrumentation
+
+#include "MemoryStats.hpp"
+#include "config.h"
+
+#include <atomic>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+static std::atomic<uint64_t> allocationCount(0), allocationBytes(0);
+
+#ifdef GLAPP_COUNT_ALLOCATIONS
+// count every global new; matching deletes must also be replaced
+void *operator new(size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocationBytes.fetch_add(size, std::memory_order_relaxed);
+    if (void *ptr = malloc(size ? size : 1)) return ptr;
+    throw std::bad_alloc();
+}
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete(void *ptr) noexcept { free(ptr); }
+void operator delete[](void *ptr) noexcept { free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { free(ptr); }
+#endif
+
+bool MemoryStats::countsAllocations()
+{
+#ifdef GLAPP_COUNT_ALLOCATIONS
+    return true;
+#else
+    return false;
+#endif
+}
+
+MemoryStats MemoryStats::current()
+{
+    MemoryStats stats;
+    stats.allocations = allocationCount.load(std::memory_order_relaxed);
+    stats.allocatedBytes = allocationBytes.load(std::memory_order_relaxed);
+
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    stats.peakRSS = counters.PeakWorkingSetSize;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    stats.peakRSS = size_t(usage.ru_maxrss);            // bytes on macOS
+#else
+    stats.peakRSS = size_t(usage.ru_maxrss) * 1024;     // kilobytes on Linux
+#endif
+#endif
+    return stats;
+}
+
+// default hook: print to stdout
+static void printStats(const char *phase, const MemoryStats &start, const MemoryStats &end)
+{
+    if (MemoryStats::countsAllocations())
+        printf("%s: %llu allocations (%.2f MB), peak RSS %.2f MB\n", phase,
+            (unsigned long long)(end.allocations - start.allocations),
+            (end.allocatedBytes - start.allocatedBytes) / 1048576., end.peakRSS / 1048576.);
+    else
+        printf("%s: peak RSS %.2f MB\n", phase, end.peakRSS / 1048576.);
+}
+
+void (*MemoryStats::hook)(const char *, const MemoryStats &, const MemoryStats &) = printStats;
@@ -0,0 +1,33 @@
+// heap allocation and peak memory instrumentation
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct MemoryStats {
+    uint64_t allocations;           // heap allocations so far, 0 if not counted
+    uint64_t allocatedBytes;        // total bytes requested by those allocations
+    size_t peakRSS;                 // peak resident memory of the process, in bytes
+
+    // stats for the process right now
+    static MemoryStats current();
+
+    // true if built with GLAPP_COUNT_ALLOCATIONS
+    static bool countsAllocations();
+
+    // called at the end of each Scope, defaults to printing the change
+    // replace to send stats elsewhere
+    static void (*hook)(const char *phase, const MemoryStats &start, const MemoryStats &end);
+
+    // measure from construction to destruction
+    class Scope;
+};
+
+class MemoryStats::Scope {
+private:
+    const char *phase;
+    MemoryStats start;
+public:
+    Scope(const char *phase) : phase(phase), start(current()) {}
+    ~Scope() { hook(phase, start, current()); }
+};
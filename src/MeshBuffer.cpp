@@ -0,0 +1,55 @@
+// GPU vertex and index buffers, shared by all objects drawing part of them
+
+#include "MeshBuffer.hpp"
+#include "GLState.hpp"
+#include "TextureResidency.hpp"
+
+#include <GL/glew.h>
+
+using namespace glm;  // avoid glm:: for all glm types and functions
+
+MeshBuffer::MeshBuffer(size_t numVerts, const vec3 *vert, const vec3 *norm,
+    const vec2 *uv, size_t numIndices, const unsigned int *indices) :
+    numVerts(numVerts), numIndices(numIndices)
+{
+    glGenBuffers(NUM_BUFFERS, bufferIDs);
+    glGenVertexArrays(1, &varrayID);
+
+    // vertex array object remembers attribute and index buffer bindings
+    GLState &gl = GLState::shared();
+    gl.bindVertexArray(varrayID);
+
+    gl.bindBuffer(GL_ARRAY_BUFFER, bufferIDs[POSITION_BUFFER]);
+    glBufferData(GL_ARRAY_BUFFER, numVerts * sizeof(vert[0]), vert, GL_STATIC_DRAW);
+    glVertexAttribPointer(POSITION_ATTRIB, 3, GL_FLOAT, GL_FALSE, 0, 0);
+    glEnableVertexAttribArray(POSITION_ATTRIB);
+
+    gl.bindBuffer(GL_ARRAY_BUFFER, bufferIDs[NORMAL_BUFFER]);
+    glBufferData(GL_ARRAY_BUFFER, numVerts * sizeof(norm[0]), norm, GL_STATIC_DRAW);
+    glVertexAttribPointer(NORMAL_ATTRIB, 3, GL_FLOAT, GL_FALSE, 0, 0);
+    glEnableVertexAttribArray(NORMAL_ATTRIB);
+
+    gl.bindBuffer(GL_ARRAY_BUFFER, bufferIDs[UV_BUFFER]);
+    glBufferData(GL_ARRAY_BUFFER, numVerts * sizeof(uv[0]), uv, GL_STATIC_DRAW);
+    glVertexAttribPointer(UV_ATTRIB, 2, GL_FLOAT, GL_FALSE, 0, 0);
+    glEnableVertexAttribArray(UV_ATTRIB);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bufferIDs[INDEX_BUFFER]);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, numIndices * sizeof(indices[0]), indices, GL_STATIC_DRAW);
+
+    gl.bindVertexArray(0);
+    TextureResidency::shared().addBuffer(memory());
+}
+
+MeshBuffer::~MeshBuffer()
+{
+    TextureResidency::shared().removeBuffer(memory());
+    glDeleteBuffers(NUM_BUFFERS, bufferIDs);
+    glDeleteVertexArrays(1, &varrayID);
+}
+
+size_t MeshBuffer::memory() const
+{
+    return numVerts * (sizeof(vec3) + sizeof(vec3) + sizeof(vec2))
+        + numIndices * sizeof(unsigned int);
+}
@@ -0,0 +1,35 @@
+// GPU vertex and index buffers, shared by all objects drawing part of them
+#pragma once
+
+#include <glm/glm.hpp>
+#include <stddef.h>
+
+class MeshBuffer {
+public:
+    // vertex attribute locations, must match layout() in shaders
+    // DRAW_ATTRIB is only used by StaticBatch
+    enum {POSITION_ATTRIB, NORMAL_ATTRIB, UV_ATTRIB, DRAW_ATTRIB};
+
+    // GL buffer object IDs
+    enum {POSITION_BUFFER, NORMAL_BUFFER, UV_BUFFER, INDEX_BUFFER, NUM_BUFFERS};
+    unsigned int bufferIDs[NUM_BUFFERS];
+
+    unsigned int varrayID;      // GL vertex array object with attributes & indices
+
+    size_t numVerts, numIndices;
+
+public:
+    // upload vertex and index arrays
+    MeshBuffer(size_t numVerts, const glm::vec3 *vert, const glm::vec3 *norm,
+        const glm::vec2 *uv, size_t numIndices, const unsigned int *indices);
+
+    // free GL objects
+    ~MeshBuffer();
+
+    // buffers own GL objects, so no copies
+    MeshBuffer(const MeshBuffer &) = delete;
+    MeshBuffer &operator=(const MeshBuffer &) = delete;
+
+    // GPU bytes used by vertex and index data
+    size_t memory() const;
+};
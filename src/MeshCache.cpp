@@ -0,0 +1,277 @@
+// binary cache of a loaded .obj model, ready to hand to the GPU
+
+#include "MeshCache.hpp"
+#include "CacheFile.hpp"
+#include "MappedFile.hpp"
+#include "MaterialLibrary.hpp"
+#include "ObjLoader.hpp"
+#include "TrianglePacket.hpp"
+#include "VertexWelder.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <stdio.h>
+#include <string.h>
+
+using namespace glm;  // avoid glm:: for all glm types and functions
+
+// append data to a cache image at 16-byte aligned offsets
+// returns offsets rather than pointers since the image may move as it grows
+class ImageWriter {
+public:
+    std::vector<char> &image;
+
+    ImageWriter(std::vector<char> &image) : image(image) {}
+
+    uint64_t append(const void *data, size_t bytes) {
+        size_t offset = (image.size() + 15) & ~size_t(15);
+        image.resize(offset + bytes);
+        if (bytes) memcpy(&image[offset], data, bytes);
+        return offset;
+    }
+    template <typename T, typename A> uint64_t append(const std::vector<T, A> &data) {
+        return append(data.data(), data.size() * sizeof(T));
+    }
+    uint64_t append(const std::string &str) {
+        return append(str.c_str(), str.size() + 1);
+    }
+
+    template <typename T> T &at(uint64_t offset) { return *(T*)&image[offset]; }
+};
+
+MeshCache::MeshCache(const char *objPath) :
+    base(nullptr), size(0)
+{
+    std::filesystem::path source = std::filesystem::absolute(objPath);
+    std::filesystem::path cachePath = cacheFileFor(source, ".mesh");
+    if (mapCache(cachePath.u8string().c_str(), source.u8string().c_str()))
+        return;
+
+    if (!build(source.u8string().c_str()))
+        return;
+
+    // save for next time
+    writeCacheFile(cachePath, image.data(), image.size());
+}
+
+MeshCache::~MeshCache()
+{
+}
+
+// map existing cache file, checking that it's complete and up to date
+bool MeshCache::mapCache(const char *cachePath, const char *objPath)
+{
+    std::unique_ptr<MappedFile> mapped(new MappedFile(cachePath));
+    if (!mapped->isOpen() || mapped->size < sizeof(Header)) return false;
+
+    const char *data = mapped->data;
+    size_t bytes = mapped->size;
+    auto inFile = [bytes](uint64_t offset, uint64_t count, size_t elementSize) {
+        return offset <= bytes && count <= (bytes - offset) / elementSize;
+    };
+    auto isString = [data, bytes](uint64_t offset) {
+        return offset < bytes && memchr(data + offset, 0, bytes - offset) != nullptr;
+    };
+
+    const Header &head = *(const Header*)data;
+    if (memcmp(head.magic, "GLMC", 4) != 0 || head.version != VERSION) return false;
+    if (!inFile(head.dependencyOffset, head.numDependencies, sizeof(Dependency)) ||
+        !inFile(head.materialOffset, head.numMaterials, sizeof(Material)) ||
+        !inFile(head.groupOffset, head.numGroups, sizeof(Group)))
+        return false;
+
+    // all sources unchanged?
+    const Dependency *deps = (const Dependency*)(data + head.dependencyOffset);
+    if (head.numDependencies == 0 || !isString(deps[0].pathOffset) ||
+        strcmp(data + deps[0].pathOffset, objPath) != 0)
+        return false;
+    for (uint32_t i = 0; i < head.numDependencies; ++i) {
+        uint64_t fileSize;
+        int64_t mtime;
+        if (!isString(deps[i].pathOffset)) return false;
+        fileStamp(std::filesystem::u8path(data + deps[i].pathOffset), fileSize, mtime);
+        if (fileSize != deps[i].size || mtime != deps[i].mtime) return false;
+    }
+
+    // every array in range?
+    const Material *mats = (const Material*)(data + head.materialOffset);
+    for (uint32_t i = 0; i < head.numMaterials; ++i)
+        if (!isString(mats[i].nameOffset) || !isString(mats[i].textureOffset))
+            return false;
+    if (!inFile(head.vertOffset, head.numVerts, sizeof(vec3)) ||
+        !inFile(head.normOffset, head.numVerts, sizeof(vec3)) ||
+        !inFile(head.uvOffset, head.numVerts, sizeof(vec2)) ||
+        !inFile(head.indexOffset, head.numIndices, sizeof(unsigned int)) ||
+        !inFile(head.packetOffset, head.numPackets, sizeof(TrianglePacket)))
+        return false;
+    const Group *grps = (const Group*)(data + head.groupOffset);
+    const unsigned int *indices = (const unsigned int*)(data + head.indexOffset);
+    for (uint32_t i = 0; i < head.numGroups; ++i) {
+        const Group &g = grps[i];
+        if (g.material >= head.numMaterials || g.firstIndex > head.numIndices ||
+            g.numIndices > head.numIndices - g.firstIndex ||
+            g.firstPacket > head.numPackets || g.numPackets > head.numPackets - g.firstPacket)
+            return false;
+        for (uint32_t j = g.firstIndex; j < g.firstIndex + g.numIndices; ++j)
+            if (int64_t(indices[j]) + g.baseVertex < 0 ||
+                int64_t(indices[j]) + g.baseVertex >= head.numVerts)
+                return false;
+    }
+
+    file = std::move(mapped);
+    base = data;
+    size = bytes;
+    return true;
+}
+
+// read all materials in one .mtl file
+static void loadMtl(const std::filesystem::path &mtlPath, MaterialLibrary &materials)
+{
+    std::ifstream mtlFile(mtlPath);
+    if (!mtlFile.is_open()) {
+        fprintf(stderr, "can't open %s\n", mtlPath.string().c_str());
+        return;
+    }
+
+    unsigned int curr = MaterialLibrary::NOT_FOUND;
+    std::string mtlToken, mtl;
+    mtlFile >> mtlToken;
+    while (!mtlFile.eof()) {
+
+        // Map texture data to mtl label
+        if (mtlToken == "newmtl") {
+            mtlFile >> mtl;
+            curr = materials.define(mtl);
+        }
+        else if (curr == MaterialLibrary::NOT_FOUND)
+            ;   // ignore properties before the first newmtl
+        else if (mtlToken == "Ka")
+            mtlFile >> materials.Ka[curr][0] >> materials.Ka[curr][1] >> materials.Ka[curr][2];
+        else if (mtlToken == "Kd")
+            mtlFile >> materials.Kd[curr][0] >> materials.Kd[curr][1] >> materials.Kd[curr][2];
+        else if (mtlToken == "Ks")
+            mtlFile >> materials.Ks[curr][0] >> materials.Ks[curr][1] >> materials.Ks[curr][2];
+        else if (mtlToken == "Ns")
+            mtlFile >> materials.Ns[curr];
+        else if (mtlToken == "map_Kd") {
+            mtlFile >> mtlToken;
+            materials.textures[curr] = (mtlPath.parent_path() / mtlToken).u8string();
+        }
+        mtlFile >> mtlToken;
+    }
+}
+
+// parse .obj and .mtl sources, then lay out cache image
+bool MeshCache::build(const char *objPath)
+{
+    // parse and weld scratch arrays are all freed with the arena
+    Arena arena;
+    ObjData obj(arena);
+    if (!loadObj(objPath, obj)) {
+        fprintf(stderr, "can't open %s\n", objPath);
+        return false;
+    }
+
+    // sources this cache depends on
+    std::vector<std::filesystem::path> sources = {std::filesystem::u8path(objPath)};
+    std::filesystem::path filePath = sources[0].parent_path();
+    for (auto &lib : obj.mtllibs)
+        sources.push_back(filePath / lib);
+
+    // material table, index 0 is the default for unknown names
+    MaterialLibrary mtl;
+    for (size_t i = 1; i < sources.size(); ++i)
+        loadMtl(sources[i], mtl);
+    std::vector<Material> materials(mtl.size());
+    for (unsigned int i = 0; i < mtl.size(); ++i)
+        materials[i] = {mtl.Ka[i], mtl.Ns[i], mtl.Kd[i], 0.f, mtl.Ks[i], 0.f, 0, 0};
+
+    // header goes first, filled in once the offsets are known
+    ImageWriter writer(image);
+    Header head = {{'G','L','M','C'}, VERSION};
+    writer.append(&head, sizeof(head));
+
+    // dependency table, sources stamped before use so later edits rebuild
+    std::vector<Dependency> deps;
+    for (auto &source : sources) {
+        Dependency dep = {0, 0, 0};
+        fileStamp(source, dep.size, dep.mtime);
+        dep.pathOffset = writer.append(source.u8string());
+        deps.push_back(dep);
+    }
+    for (size_t i = 0; i < materials.size(); ++i) {
+        materials[i].nameOffset = writer.append(mtl.names[i]);
+        materials[i].textureOffset = writer.append(mtl.textures[i]);
+    }
+
+    // one GPU vertex per distinct (v, vt, vn) corner
+    // vertex arrays are reserved for the worst case of no shared corners,
+    // which costs address space but no memory for the pages never written
+    VertexWelder welder(arena, std::max(obj.vVert.size(), std::max(obj.vtVert.size(), obj.vnVert.size())));
+    ArenaVector<vec3> vert(arena), norm(arena);
+    ArenaVector<vec2> uv(arena);
+    ArenaVector<unsigned int> indices(obj.fVert.size(), 0u, arena);
+    vert.reserve(obj.fVert.size());
+    norm.reserve(obj.fVert.size());
+    uv.reserve(obj.fVert.size());
+    for (size_t i = 0; i < obj.fVert.size(); ++i) {
+        unsigned int v = obj.fVert[i], vt = obj.vtIndex[i], vn = obj.vnIndex[i];
+        bool isNew;
+        indices[i] = welder.weld(v, vt, vn, isNew);
+        if (isNew) {
+            vert.push_back(obj.vVert[v]);
+            norm.push_back(vn != ObjData::NO_INDEX ? obj.vnVert[vn] : vec3(0, 0, 0));
+            uv.push_back(vt != ObjData::NO_INDEX ? obj.vtVert[vt] : vec2(0, 0));
+        }
+    }
+    const size_t vertexBytes = sizeof(vec3) + sizeof(vec3) + sizeof(vec2);
+    printf("%s: welded %zu positions, %zu corners into %u vertices (%.2f MB, unwelded %.2f MB, table %.2f MB)\n",
+        sources[0].filename().string().c_str(), obj.vVert.size(), indices.size(), welder.size(),
+        welder.size() * vertexBytes / 1048576., indices.size() * vertexBytes / 1048576.,
+        welder.memory() / 1048576.);
+
+    // vertex and index arrays are shared by all groups
+    // each group's triangles are packed separately, so its objects test only their own
+    std::vector<Group> groups;
+    std::vector<TrianglePacket> packets;
+    for (auto &objGroup : obj.groups) {
+        uint32_t material = mtl.find(objGroup.material);
+        if (material == MaterialLibrary::NOT_FOUND) material = MaterialLibrary::DEFAULT;
+        uint32_t firstPacket = uint32_t(packets.size());
+        TrianglePacket::build(vert.data(), indices.data() + objGroup.firstIndex, objGroup.numIndices, packets);
+        groups.push_back({material, objGroup.firstIndex, objGroup.numIndices, 0,
+            firstPacket, uint32_t(packets.size()) - firstPacket});
+    }
+    head.numVerts = welder.size();
+    head.numIndices = uint32_t(indices.size());
+    head.numPackets = uint32_t(packets.size());
+    // grow image once for all bulk arrays, plus alignment padding
+    image.reserve(image.size() + 16 * 5 +
+        vert.size() * (sizeof(vec3) + sizeof(vec3) + sizeof(vec2)) +
+        indices.size() * sizeof(unsigned int) +
+        packets.size() * sizeof(TrianglePacket));
+    head.vertOffset = writer.append(vert);
+    head.normOffset = writer.append(norm);
+    head.uvOffset = writer.append(uv);
+    head.indexOffset = writer.append(indices);
+    head.packetOffset = writer.append(packets);
+
+    head.numDependencies = uint32_t(deps.size());
+    head.numMaterials = uint32_t(materials.size());
+    head.numGroups = uint32_t(groups.size());
+    head.dependencyOffset = writer.append(deps);
+    head.materialOffset = writer.append(materials);
+    head.groupOffset = writer.append(groups);
+    head.lo = obj.lo;
+    head.hi = obj.hi;
+    writer.at<Header>(0) = head;
+
+    printf("%s: loader arena %.2f MB in %zu blocks\n", sources[0].filename().string().c_str(),
+        arena.bytesReserved() / 1048576., arena.numBlocks());
+
+    base = image.data();
+    size = image.size();
+    return true;
+}
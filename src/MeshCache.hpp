@@ -0,0 +1,96 @@
+// binary cache of a loaded .obj model, ready to hand to the GPU
+//
+// Built on first load and written to the cache directory. Later loads
+// map the file and use the arrays in place, skipping .obj/.mtl parsing
+// and intersection precomputation.
+#pragma once
+
+#include <glm/glm.hpp>
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+class MeshCache {
+public:
+    // bump when the layout of any of these structures changes
+    enum { VERSION = 5 };
+
+    // file layout: Header, then arrays found by byte offset from file start
+    // all arrays are 16-byte aligned, strings are nul terminated
+    struct Header {
+        char magic[4];                  // "GLMC"
+        uint32_t version;               // VERSION
+        uint32_t numDependencies;       // source files, .obj first
+        uint32_t numMaterials;
+        uint32_t numGroups;
+        uint32_t numVerts;              // entries in vert/norm/uv
+        uint32_t numIndices;            // entries in indices, 3 per triangle
+        uint32_t numPackets;            // entries in packet array
+        uint64_t dependencyOffset;      // Dependency[numDependencies]
+        uint64_t materialOffset;        // Material[numMaterials]
+        uint64_t groupOffset;           // Group[numGroups]
+
+        // model data shared by all groups
+        uint64_t vertOffset, normOffset, uvOffset, indexOffset;
+        uint64_t packetOffset;          // TrianglePacket[numPackets], each group's packed separately
+        glm::vec3 lo, hi;               // bounding box of all vertices
+    };
+
+    // source file the cache was built from
+    struct Dependency {
+        uint64_t pathOffset;            // file path string
+        uint64_t size;                  // file size in bytes
+        int64_t mtime;                  // modification time, filesystem clock
+    };
+
+    // .mtl material
+    struct Material {
+        glm::vec3 Ka; float Ns;         // ambient color & specular exponent
+        glm::vec3 Kd; float pad0;       // diffuse color
+        glm::vec3 Ks; float pad1;       // specular color
+        uint64_t nameOffset;            // newmtl name string
+        uint64_t textureOffset;         // map_Kd path string, "" for none
+    };
+
+    // one usemtl group, drawn as one object from the shared arrays
+    struct Group {
+        uint32_t material;              // index into material table
+        uint32_t firstIndex;            // range in the model index array
+        uint32_t numIndices;
+        int32_t baseVertex;             // added to each index in range
+        uint32_t firstPacket;           // range in the packet array, for intersection
+        uint32_t numPackets;
+    };
+
+private:
+    std::unique_ptr<class MappedFile> file;     // cache file, if mapped
+    std::vector<char> image;                    // cache in memory, if not
+    const char *base;                           // start of cache data
+    size_t size;                                // bytes of cache data
+
+public:
+    // find a current cache for objPath, building it if necessary
+    // check isValid() for success
+    MeshCache(const char *objPath);
+    ~MeshCache();
+
+    bool isValid() const { return base != nullptr; }
+    bool isMapped() const { return file != nullptr; }  // loaded from cache file?
+
+    // cached contents
+    const Header &header() const { return *(const Header*)base; }
+    const Dependency *dependencies() const { return array<Dependency>(header().dependencyOffset); }
+    const Material *materials() const { return array<Material>(header().materialOffset); }
+    const Group *groups() const { return array<Group>(header().groupOffset); }
+
+    // pointer to typed array or string at byte offset in the cache
+    template <typename T> const T *array(uint64_t offset) const { return (const T*)(base + offset); }
+    const char *string(uint64_t offset) const { return base + offset; }
+
+private:
+    // map file and check it against current sources
+    bool mapCache(const char *cachePath, const char *objPath);
+
+    // parse sources into image
+    bool build(const char *objPath);
+};
@@ -0,0 +1,435 @@
+// Wavefront .obj loading
+//
+// Parses in place over a memory-mapped file. Numbers are converted by
+// hand rather than through strings, so the only allocations are growth
+// of the output arrays and the occasional material name.
+//
+// Large files are split at line boundaries into chunks parsed in
+// parallel, then stitched back together in file order. A small file is
+// just a single chunk, so both cases share one code path and give
+// identical results.
+
+#include "ObjLoader.hpp"
+#include "MappedFile.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+using namespace glm;  // avoid glm:: for all glm types and functions
+
+// exactly representable powers of 10 for float conversion
+static const double pow10Table[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static inline bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+static inline bool isDigit(char c) { return unsigned(c - '0') < 10; }
+
+// skip spaces and tabs, but not newlines
+static inline const char *skipSpace(const char *p, const char *end)
+{
+    while (p < end && isSpace(*p)) ++p;
+    return p;
+}
+
+// advance to the start of the next line
+static inline const char *skipLine(const char *p, const char *end)
+{
+    while (p < end && *p != '\n') ++p;
+    return p < end ? p + 1 : end;
+}
+
+// read a decimal float at p, returning the character after it
+static const char *parseFloat(const char *p, const char *end, float &value)
+{
+    p = skipSpace(p, end);
+
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) negative = (*p++ == '-');
+
+    // mantissa as an integer, keeping at most 19 significant digits
+    uint64_t mantissa = 0;
+    int digits = 0, exponent = 0;
+    for (; p < end && isDigit(*p); ++p) {
+        if (digits < 19) { mantissa = mantissa * 10 + (*p - '0'); if (mantissa) ++digits; }
+        else ++exponent;
+    }
+    if (p < end && *p == '.') {
+        for (++p; p < end && isDigit(*p); ++p) {
+            if (digits < 19) { mantissa = mantissa * 10 + (*p - '0'); if (mantissa) ++digits; --exponent; }
+        }
+    }
+
+    // optional exponent
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char *e = p + 1;
+        bool negExp = false;
+        if (e < end && (*e == '-' || *e == '+')) negExp = (*e++ == '-');
+        if (e < end && isDigit(*e)) {
+            int exp = 0;
+            for (; e < end && isDigit(*e); ++e)
+                if (exp < 10000) exp = exp * 10 + (*e - '0');
+            exponent += negExp ? -exp : exp;
+            p = e;
+        }
+    }
+
+    double result = double(mantissa);
+    if (exponent < 0 && exponent >= -22)
+        result /= pow10Table[-exponent];
+    else if (exponent > 0 && exponent <= 22)
+        result *= pow10Table[exponent];
+    else if (exponent != 0)
+        result *= pow(10., exponent);
+
+    value = float(negative ? -result : result);
+    return p;
+}
+
+// read a signed decimal integer at p, returning the character after it
+static inline const char *parseInt(const char *p, const char *end, int &value)
+{
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) negative = (*p++ == '-');
+
+    int result = 0;
+    for (; p < end && isDigit(*p); ++p)
+        result = result * 10 + (*p - '0');
+
+    value = negative ? -result : result;
+    return p;
+}
+
+// don't bother splitting files smaller than this
+static const size_t MIN_CHUNK_SIZE = 1 << 20;
+
+// piece of the file parsed independently of the others
+struct ObjChunk {
+    const char *begin, *end;            // lines in this chunk
+
+    // parsed data with chunk-local counts
+    // groups[0] continues whatever material was current at chunk start
+    Arena arena;                        // per chunk, so threads don't share
+    ObjData data;
+
+    // corners that used negative (relative) v, vt or vn indices
+    // stored relative to this chunk's start, fixed when stitching
+    std::vector<unsigned int> relative[3];
+
+    // global offsets of this chunk's data, filled when stitching
+    size_t vBase, vtBase, vnBase, indexBase;
+
+    ObjChunk() : data(arena) {}
+};
+
+void ObjData::clear()
+{
+    // swap with empty arrays, since clear() would keep the capacity
+    ArenaVector<vec3>(vVert.get_allocator()).swap(vVert);
+    ArenaVector<vec3>(vnVert.get_allocator()).swap(vnVert);
+    ArenaVector<vec2>(vtVert.get_allocator()).swap(vtVert);
+    ArenaVector<unsigned int>(fVert.get_allocator()).swap(fVert);
+    ArenaVector<unsigned int>(vtIndex.get_allocator()).swap(vtIndex);
+    ArenaVector<unsigned int>(vnIndex.get_allocator()).swap(vnIndex);
+    groups.clear();
+    mtllibs.clear();
+}
+
+// convert 1-based or negative relative .obj index to 0-based
+// positive indices are final, relative ones are local to the chunk and
+// recorded for fixing later. Range checks wait until all counts are known.
+static inline unsigned int chunkIndex(int index, size_t count, size_t corner,
+    std::vector<unsigned int> &relative)
+{
+    if (index > 0) return unsigned(index - 1);
+    if (index == 0) return ObjData::NO_INDEX;
+    relative.push_back(unsigned(corner));
+    return unsigned(count + index);     // may wrap, fixed by adding chunk base
+}
+
+// rest of line as a name, without trailing whitespace
+static const char *parseName(const char *p, const char *end, std::string &name)
+{
+    p = skipSpace(p, end);
+    const char *start = p;
+    while (p < end && *p != '\n' && *p != '#') ++p;
+    const char *last = p;
+    while (last > start && isSpace(last[-1])) --last;
+    name.assign(start, last);
+    return p;
+}
+
+// does the keyword at p match, followed by whitespace?
+static inline bool isKeyword(const char *p, const char *end, const char *keyword, size_t len)
+{
+    return size_t(end - p) > len && isSpace(p[len]) && memcmp(p, keyword, len) == 0;
+}
+
+// quick first pass counting array entries, so they can be allocated once
+static void reserveChunk(ObjChunk &chunk)
+{
+    size_t numV = 0, numVt = 0, numVn = 0, numIndices = 0;
+    const char *p = chunk.begin, *end = chunk.end;
+    while (p < end) {
+        p = skipSpace(p, end);
+        if (end - p > 2 && p[0] == 'v') {
+            if (isSpace(p[1])) ++numV;
+            else if (p[1] == 't' && isSpace(p[2])) ++numVt;
+            else if (p[1] == 'n' && isSpace(p[2])) ++numVn;
+        }
+        else if (end - p > 1 && p[0] == 'f' && isSpace(p[1])) {
+            // polygon with n corners makes n-2 triangles
+            size_t corners = 0;
+            for (++p; p < end && *p != '\n' && *p != '#'; ++p)
+                if (isSpace(p[-1]) && !isSpace(*p)) ++corners;
+            if (corners > 2) numIndices += 3 * (corners - 2);
+        }
+        const char *nl = (const char*)memchr(p, '\n', end - p);
+        p = nl ? nl + 1 : end;
+    }
+
+    ObjData &data = chunk.data;
+    data.vVert.reserve(numV);
+    data.vtVert.reserve(numVt);
+    data.vnVert.reserve(numVn);
+    data.fVert.reserve(numIndices);
+    data.vtIndex.reserve(numIndices);
+    data.vnIndex.reserve(numIndices);
+}
+
+// parse lines of one chunk into chunk.data
+static void parseChunk(ObjChunk &chunk)
+{
+    reserveChunk(chunk);
+
+    ObjData &data = chunk.data;
+    data.lo = vec3(INFINITY);
+    data.hi = vec3(-INFINITY);
+
+    // initial group continues the material from the previous chunk
+    data.groups.push_back({"", 0, 0});
+
+    const char *p = chunk.begin, *end = chunk.end;
+    while (p < end) {
+        p = skipSpace(p, end);
+        if (p == end) break;
+
+        if (p[0] == 'v' && p + 1 < end && isSpace(p[1])) {           // v
+            vec3 v;
+            p = parseFloat(p + 2, end, v.x);
+            p = parseFloat(p, end, v.y);
+            p = parseFloat(p, end, v.z);
+            data.vVert.push_back(v);
+            data.lo = min(data.lo, v);
+            data.hi = max(data.hi, v);
+        }
+        else if (p[0] == 'v' && isKeyword(p, end, "vt", 2)) {        // uv
+            vec2 vt;
+            p = parseFloat(p + 3, end, vt.x);
+            p = parseFloat(p, end, vt.y);
+            data.vtVert.push_back(vt);
+        }
+        else if (p[0] == 'v' && isKeyword(p, end, "vn", 2)) {        // norm
+            vec3 vn;
+            p = parseFloat(p + 3, end, vn.x);
+            p = parseFloat(p, end, vn.y);
+            p = parseFloat(p, end, vn.z);
+            data.vnVert.push_back(vn);
+        }
+        else if (p[0] == 'f' && p + 1 < end && isSpace(p[1])) {      // indices
+            // polygon corners v, v/vt, v//vn or v/vt/vn, fan triangulated
+            int first[3], prev[3];
+            int corners = 0;
+            for (p = skipSpace(p + 2, end); p < end && *p != '\n' && *p != '#';
+                 p = skipSpace(p, end)) {
+                int corner[3] = {0, 0, 0};
+                p = parseInt(p, end, corner[0]);
+                if (p < end && *p == '/') {
+                    if (++p < end && *p != '/') p = parseInt(p, end, corner[1]);
+                    if (p < end && *p == '/') p = parseInt(p + 1, end, corner[2]);
+                }
+
+                // skip anything we didn't understand in this corner
+                while (p < end && !isSpace(*p) && *p != '\n') ++p;
+                if (corner[0] == 0) continue;
+
+                if (corners >= 2) {
+                    const int *triangle[3] = {first, prev, corner};
+                    for (auto c : triangle) {
+                        size_t at = data.fVert.size();
+                        data.fVert.push_back(chunkIndex(c[0], data.vVert.size(), at, chunk.relative[0]));
+                        data.vtIndex.push_back(chunkIndex(c[1], data.vtVert.size(), at, chunk.relative[1]));
+                        data.vnIndex.push_back(chunkIndex(c[2], data.vnVert.size(), at, chunk.relative[2]));
+                    }
+                }
+                for (int i = 0; i < 3; ++i) {
+                    if (corners == 0) first[i] = corner[i];
+                    prev[i] = corner[i];
+                }
+                ++corners;
+            }
+        }
+        else if (isKeyword(p, end, "usemtl", 6)) {
+            // start a new group, empty ones are removed when stitching
+            data.groups.push_back({"", unsigned(data.fVert.size()), 0});
+            p = parseName(p + 6, end, data.groups.back().material);
+        }
+        else if (isKeyword(p, end, "mtllib", 6)) {
+            data.mtllibs.emplace_back();
+            p = parseName(p + 6, end, data.mtllibs.back());
+        }
+
+        // done with this line: skip comments and anything unparsed
+        p = skipLine(p, end);
+    }
+}
+
+// copy chunk's arrays into their place in the full data
+// return number of triangles with an out of range position index
+static size_t stitchChunk(ObjChunk &chunk, ObjData &data)
+{
+    ObjData &local = chunk.data;
+    std::copy(local.vVert.begin(),  local.vVert.end(),  data.vVert.begin()  + chunk.vBase);
+    std::copy(local.vtVert.begin(), local.vtVert.end(), data.vtVert.begin() + chunk.vtBase);
+    std::copy(local.vnVert.begin(), local.vnVert.end(), data.vnVert.begin() + chunk.vnBase);
+
+    // relative indices become absolute once the chunk base is known
+    ArenaVector<unsigned int> *index[3] = {&local.fVert, &local.vtIndex, &local.vnIndex};
+    const size_t base[3] = {chunk.vBase, chunk.vtBase, chunk.vnBase};
+    for (int i = 0; i < 3; ++i)
+        for (unsigned int corner : chunk.relative[i])
+            (*index[i])[corner] += unsigned(base[i]);
+
+    // range check against the final counts
+    size_t numV = data.vVert.size(), numVt = data.vtVert.size(), numVn = data.vnVert.size();
+    for (size_t i = 0; i < local.fVert.size(); ++i) {
+        if (local.vtIndex[i] >= numVt) local.vtIndex[i] = ObjData::NO_INDEX;
+        if (local.vnIndex[i] >= numVn) local.vnIndex[i] = ObjData::NO_INDEX;
+    }
+    size_t badTriangles = 0;
+    for (size_t i = 0; i < local.fVert.size(); i += 3)
+        if (local.fVert[i] >= numV || local.fVert[i+1] >= numV || local.fVert[i+2] >= numV)
+            ++badTriangles;
+
+    std::copy(local.fVert.begin(),   local.fVert.end(),   data.fVert.begin()   + chunk.indexBase);
+    std::copy(local.vtIndex.begin(), local.vtIndex.end(), data.vtIndex.begin() + chunk.indexBase);
+    std::copy(local.vnIndex.begin(), local.vnIndex.end(), data.vnIndex.begin() + chunk.indexBase);
+
+    // release chunk memory as soon as it has been copied
+    chunk.data.clear();
+    chunk.arena.release();
+    for (auto &relative : chunk.relative) relative = {};
+    return badTriangles;
+}
+
+// remove triangles using position indices that are out of range
+static void removeBadTriangles(ObjData &data)
+{
+    size_t numV = data.vVert.size();
+    unsigned int out = 0;
+    for (auto &group : data.groups) {
+        unsigned int in = group.firstIndex, last = in + group.numIndices;
+        group.firstIndex = out;
+        for (; in < last; in += 3) {
+            if (data.fVert[in] >= numV || data.fVert[in+1] >= numV || data.fVert[in+2] >= numV)
+                continue;
+            for (unsigned int i = in; i < in + 3; ++i, ++out) {
+                data.fVert[out] = data.fVert[i];
+                data.vtIndex[out] = data.vtIndex[i];
+                data.vnIndex[out] = data.vnIndex[i];
+            }
+        }
+        group.numIndices = out - group.firstIndex;
+    }
+    data.fVert.resize(out);
+    data.vtIndex.resize(out);
+    data.vnIndex.resize(out);
+    data.groups.erase(std::remove_if(data.groups.begin(), data.groups.end(),
+        [](const ObjData::Group &group) { return group.numIndices == 0; }), data.groups.end());
+}
+
+bool loadObj(const char *path, ObjData &data)
+{
+    MappedFile file(path);
+    if (!file.isOpen()) return false;
+
+    // split at line boundaries, with a few chunks per thread for balance
+    ThreadPool &pool = ThreadPool::shared();
+    size_t numChunks = std::min(file.size / MIN_CHUNK_SIZE + 1, size_t(4 * pool.size()));
+    std::vector<ObjChunk> chunks(numChunks);
+    const char *start = file.data;
+    for (size_t i = 0; i < numChunks; ++i) {
+        const char *split = file.data + file.size * (i + 1) / numChunks;
+        if (split > start) split = skipLine(split - 1, file.end());
+        else split = start;
+        chunks[i].begin = start;
+        chunks[i].end = start = split;
+    }
+
+    // run one task per chunk and wait for all of them
+    auto forEachChunk = [&](std::function<void(ObjChunk&)> task) {
+        if (numChunks == 1) {
+            task(chunks[0]);
+            return;
+        }
+        std::vector<std::future<void>> done;
+        for (auto &chunk : chunks)
+            done.push_back(pool.enqueue([&task, &chunk] { task(chunk); }));
+        for (auto &d : done) d.get();
+    };
+
+    forEachChunk(parseChunk);
+
+    // chunk offsets in the stitched arrays
+    size_t numV = 0, numVt = 0, numVn = 0, numIndices = 0;
+    for (auto &chunk : chunks) {
+        chunk.vBase = numV;       numV  += chunk.data.vVert.size();
+        chunk.vtBase = numVt;     numVt += chunk.data.vtVert.size();
+        chunk.vnBase = numVn;     numVn += chunk.data.vnVert.size();
+        chunk.indexBase = numIndices; numIndices += chunk.data.fVert.size();
+    }
+
+    data.clear();
+    data.vVert.resize(numV);
+    data.vtVert.resize(numVt);
+    data.vnVert.resize(numVn);
+    data.fVert.resize(numIndices);
+    data.vtIndex.resize(numIndices);
+    data.vnIndex.resize(numIndices);
+    data.lo = vec3(INFINITY);
+    data.hi = vec3(-INFINITY);
+
+    // groups, libraries and bounds in file order
+    // first group of each later chunk just extends the previous one
+    for (auto &chunk : chunks) {
+        auto &groups = chunk.data.groups;
+        for (auto group = groups.begin() + (&chunk == &chunks[0] ? 0 : 1); group != groups.end(); ++group) {
+            data.groups.push_back(std::move(*group));
+            data.groups.back().firstIndex += unsigned(chunk.indexBase);
+        }
+        for (auto &lib : chunk.data.mtllibs)
+            data.mtllibs.push_back(std::move(lib));
+        data.lo = min(data.lo, chunk.data.lo);
+        data.hi = max(data.hi, chunk.data.hi);
+    }
+
+    // group sizes from where the next one starts, dropping empty groups
+    for (size_t i = 0; i < data.groups.size(); ++i) {
+        unsigned int next = i + 1 < data.groups.size() ? data.groups[i+1].firstIndex : unsigned(numIndices);
+        data.groups[i].numIndices = next - data.groups[i].firstIndex;
+    }
+    data.groups.erase(std::remove_if(data.groups.begin(), data.groups.end(),
+        [](const ObjData::Group &group) { return group.numIndices == 0; }), data.groups.end());
+
+    // copy chunk arrays into place
+    std::vector<size_t> badTriangles(numChunks);
+    forEachChunk([&](ObjChunk &chunk) { badTriangles[&chunk - &chunks[0]] = stitchChunk(chunk, data); });
+    for (size_t bad : badTriangles)
+        if (bad) { removeBadTriangles(data); break; }
+
+    return true;
+}
@@ -0,0 +1,45 @@
+// Wavefront .obj loading
+#pragma once
+
+#include "Arena.hpp"
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+// raw contents of an .obj file, indices already converted to 0-based
+// bulk arrays live in an arena, to be dropped all at once after loading
+struct ObjData {
+    // vertex attributes, in file order
+    ArenaVector<glm::vec3> vVert;           // v lines: positions
+    ArenaVector<glm::vec3> vnVert;          // vn lines: normals
+    ArenaVector<glm::vec2> vtVert;          // vt lines: texture coordinates
+
+    // 3 corners per triangle, polygons are fan triangulated
+    // vtIndex and vnIndex are NO_INDEX when the face doesn't give one
+    enum : unsigned int { NO_INDEX = ~0u };
+    ArenaVector<unsigned int> fVert, vtIndex, vnIndex;
+
+    // run of triangles drawn with one usemtl material
+    struct Group {
+        std::string material;               // usemtl name
+        unsigned int firstIndex;            // first corner in fVert/vtIndex/vnIndex
+        unsigned int numIndices;            // corner count, 3 per triangle
+    };
+    std::vector<Group> groups;
+
+    std::vector<std::string> mtllibs;       // mtllib file names, relative to .obj
+
+    glm::vec3 lo, hi;                       // bounding box of vVert
+
+    // empty data with arrays allocated from arena
+    ObjData(Arena &arena) :
+        vVert(arena), vnVert(arena), vtVert(arena),
+        fVert(arena), vtIndex(arena), vnIndex(arena) {}
+
+    // empty all arrays, giving up their memory
+    void clear();
+};
+
+// parse an .obj file into data
+// return false if the file could not be read
+bool loadObj(const char *path, ObjData &data);
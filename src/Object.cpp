@@ -2,197 +2,170 @@
 
 #include "Object.hpp"
 #include "GLapp.hpp"
-#include "config.h"
+#include "GLState.hpp"
+#include "MaterialLibrary.hpp"
+#include "ShaderCache.hpp"
+#include "TextureArray.hpp"
+#include "TextureCache.hpp"
+#include "TextureResidency.hpp"
 
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
-#include <filesystem>
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
+#include <string>
 
 using namespace glm;  // avoid glm:: for all glm types and functions
 
-#ifdef _WIN32
-// don't complain if we use standard IO functions instead of windows-only
-#pragma warning( disable: 4996 )
-#endif
-
-Object::Object(const char *texturePPM)
+Object::Object(const char *texturePPM) :
+    firstIndex(0), numIndices(0), baseVertex(0), lo(0), hi(0), uniformOffset(0),
+    programFeatures(0), batched(false)
 {
-    // create buffer objects to be used later
-    glGenTextures(NUM_TEXTURES, textureIDs);
-    glGenBuffers(NUM_BUFFERS, bufferIDs);
-    glGenVertexArrays(1, &varrayID);
-
-    // load color image into a named texture
-    loadPPM(texturePPM, textureIDs[COLOR_TEXTURE]);
+    // color image, loaded once for all objects using it
+    textures[COLOR_TEXTURE] = TextureCache::shared().get(texturePPM);
 
-    // default to position at origin, white ambient and diffuse, no specular
+    // default to position at origin, with the default material
     objectShaderData = {
         mat4(1),        // WorldFromModel
         mat4(1),        // ModelFromWorld
-        vec3(1), 0.,    // ambient color & padding
-        vec3(1), 0.,    // diffuse color & padding
-        vec4(0)         // specular color & exponent
+        MaterialLibrary::DEFAULT,   // material
+        -1, 0, 0                    // texture not packed & padding
     };
-
-    // initial shader load
-    shaderParts = {
-        {glCreateShader(GL_VERTEX_SHADER  ), "object.vert"},
-        {glCreateShader(GL_FRAGMENT_SHADER), "object.frag"}
-    };
-    shaderID = glCreateProgram();
 }
 
 Object::~Object()
 {
-    for (auto shader : shaderParts)
-       glDeleteShader(shader.id);
-    glDeleteProgram(shaderID);
-    glDeleteTextures(NUM_TEXTURES, textureIDs);
-    glDeleteBuffers(NUM_BUFFERS, bufferIDs);
-    glDeleteVertexArrays(1, &varrayID);
 }
 
 
-void Object::loadPPM(const char *imagefile, unsigned int bufferID)
+// load vertex and index arrays to GPU
+void Object::initGPUData() 
 {
-    // set active texture for later texture calls
-    glBindTexture(GL_TEXTURE_2D, bufferID);
-
-    // can detect 1x1 texture size in shader for missing texture
-    if (imagefile == nullptr || imagefile[0] == '\0') {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
-        return;
+    assert(norm.size() == vert.size() && uv.size() == vert.size());
+    if (!vert.empty()) lo = hi = vert[0];
+    for (const vec3 &v : vert) {
+        lo = min(lo, v);
+        hi = max(hi, v);
     }
-
-    // open file in project data directory
-    std::filesystem::path ppmPath(imagefile);
-    if (ppmPath.is_relative()) ppmPath = std::filesystem::path(PROJECT_DATA_DIR) / ppmPath;
-    FILE* fp = fopen(ppmPath.u8string().c_str(), "rb");
-    assert(fp);
-
-    // check that "magic number" at beginning of file is P6
-    if (fgetc(fp) != 'P' || fgetc(fp) != '6') {
-        fprintf(stderr, "unknown image format %s\n", ppmPath.string().c_str());
-        assert(false);
-    }
-
-    // read image size, maximum value, and blank following header
-    int width = 0, height = 0, maxval = 0, lf = 0;
-    fscanf(fp, " #%*[^\n]");                // skip comment (if there)
-    fscanf(fp, "%d %d", &width, &height);   // read image size
-    assert(width > 0 && height > 0);
-
-    fscanf(fp, " #%*[^\n]");                // skip comment (if there)
-    fscanf(fp, "%d", &maxval);              // skip max value
-    assert(maxval == 255);
-
-    lf = fgetc(fp);                         // skip final \n before data
-    assert(lf == '\n');
-
-    // check remaining file size matches image size
-    // if this fails, you may have checked a ppm file out
-    // as text rather than binary
-    long headerEnd = ftell(fp);
-    fseek(fp, 0, SEEK_END);
-    long fileEnd = ftell(fp);
-    fseek(fp, headerEnd, SEEK_SET);
-    assert(fileEnd - headerEnd == width*height*3);
-
-    // allocate image and read array, flipping in y
-    u8vec3 *image = new u8vec3[width * height];
-    for (int y=height-1; y >= 0; --y)
-        fread(&image[y * width], sizeof(u8vec3), width, fp);
-    fclose(fp);
-
-    // load into texture
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-
-    delete[] image;
+    initGPUData(std::make_shared<MeshBuffer>(vert.size(), vert.data(), norm.data(), uv.data(),
+        indices.size(), indices.data()), 0, unsigned(indices.size()), 0);
 }
 
-// load vertex and index arrays to GPU
-void Object::initGPUData() 
+// use range of shared vertex and index arrays
+void Object::initGPUData(std::shared_ptr<MeshBuffer> sharedMesh,
+    unsigned int first, unsigned int count, int base)
 {
-    glBindBuffer(GL_UNIFORM_BUFFER, bufferIDs[OBJECT_UNIFORM_BUFFER]);
-    glBufferData(GL_UNIFORM_BUFFER, sizeof(ObjectShaderData), &objectShaderData, GL_STREAM_DRAW);
+    mesh = sharedMesh;
+    firstIndex = first;
+    numIndices = count;
+    baseVertex = base;
+}
 
-    glBindBuffer(GL_ARRAY_BUFFER, bufferIDs[POSITION_BUFFER]);
-    glBufferData(GL_ARRAY_BUFFER, vert.size() * sizeof(vert[0]), &vert[0], GL_STATIC_DRAW);
+// triangles from the CPU arrays, in world space
+void Object::collisionTriangles(std::vector<vec3> &corners) const
+{
+    for (size_t i = 0; i < indices.size() / 3 * 3; ++i)
+        corners.push_back(vec3(objectShaderData.WorldFromModel * vec4(vert[indices[i]], 1)));
+}
 
-    glBindBuffer(GL_ARRAY_BUFFER, bufferIDs[NORMAL_BUFFER]);
-    glBufferData(GL_ARRAY_BUFFER, norm.size() * sizeof(norm[0]), &norm[0], GL_STATIC_DRAW);
+// features from texture & material state
+unsigned int Object::shaderFeatures(const GLapp *app) const
+{
+    unsigned int features = 0;
+    const Texture &color = *textures[COLOR_TEXTURE];
+    if (color.array)
+        features |= HAS_TEXTURE_ARRAY;
+    else if (color.width > 1 || color.height > 1)
+        features |= HAS_TEXTURE;
+    if (app->materials.Ks[objectShaderData.Material] != vec3(0))
+        features |= HAS_SPECULAR;
+    return features;
+}
 
-    glBindBuffer(GL_ARRAY_BUFFER, bufferIDs[UV_BUFFER]);
-    glBufferData(GL_ARRAY_BUFFER, uv.size() * sizeof(uv[0]), &uv[0], GL_STATIC_DRAW);
+// use the shared object shader program for these features
+void Object::updateShaders()
+{
+    program = programFor(programFeatures);
+}
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bufferIDs[INDEX_BUFFER]);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(indices[0]), &indices[0], GL_STATIC_DRAW);
+std::shared_ptr<ShaderProgram> Object::programFor(unsigned int features)
+{
+    static const char *featureNames[NUM_FEATURES] = {
+        "HAS_TEXTURE", "HAS_TEXTURE_ARRAY", "HAS_SPECULAR", "STATIC_BATCH"
+    };
+    std::string defines;
+    for (int i = 0; i < NUM_FEATURES; ++i)
+        if (features & (1u << i))
+            defines += std::string("#define ") + featureNames[i] + "\n";
 
-    updateShaders();
+    return ShaderCache::shared().get("object.vert", "object.frag", defines, setupProgram);
 }
 
-// load or replace object shaders
-void Object::updateShaders()
+// set program state that is lost on relinking
+void Object::setupProgram(unsigned int shaderID)
 {
-    loadShaders(shaderID, shaderParts);
-    glUseProgram(shaderID);
-
     // Bind uniform block #s to their shader names. Indices should match glBindBufferBase in draw
     glUniformBlockBinding(shaderID, glGetUniformBlockIndex(shaderID,"SceneData"),  0);
     glUniformBlockBinding(shaderID, glGetUniformBlockIndex(shaderID,"ObjectData"), 1);
+    glUniformBlockBinding(shaderID, glGetUniformBlockIndex(shaderID,"MaterialData"), 2);
 
     // Map shader name for texture. 0 says to use GL_TEXTURE0: should match setRenderState
     glUniform1i(glGetUniformLocation(shaderID, "ColorTexture"), 0);
 
-    // bind attribute arrays
-    glBindVertexArray(varrayID);
+    // texture arrays use the units after that, see TextureCache::bindArrays
+    int arrayUnits[TextureArray::MAX_ARRAYS];
+    for (int i = 0; i < TextureArray::MAX_ARRAYS; ++i)
+        arrayUnits[i] = TextureArray::FIRST_UNIT + i;
+    glUniform1iv(glGetUniformLocation(shaderID, "TextureArrays"), TextureArray::MAX_ARRAYS, arrayUnits);
+}
 
-    GLint positionAttrib = glGetAttribLocation(shaderID, "vPosition");
-    glBindBuffer(GL_ARRAY_BUFFER, bufferIDs[POSITION_BUFFER]);
-    glVertexAttribPointer(positionAttrib, 3, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(positionAttrib);
+// pick program & texture state, so RenderQueue can sort by it
+void Object::prepare(GLapp *app, double now)
+{
+    // switch shader variants if texture or material changed
+    unsigned int features = shaderFeatures(app);
+    if (!program || features != programFeatures) {
+        programFeatures = features;
+        updateShaders();
+    }
 
-    GLint normalAttrib = glGetAttribLocation(shaderID, "vNormal");
-    glBindBuffer(GL_ARRAY_BUFFER, bufferIDs[NORMAL_BUFFER]);
-    glVertexAttribPointer(normalAttrib, 3, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(normalAttrib);
+    // packed textures are already bound with the rest of the scene's arrays,
+    // so just point the shader at the layer
+    // either way, reload full resolution if it was evicted
+    Texture &color = *textures[COLOR_TEXTURE];
+    if (color.array) {
+        TextureResidency::shared().use(*color.array);
+        objectShaderData.ColorArray = color.array->index;
+        objectShaderData.ColorLayer = color.layer;
+    }
+    else
+        TextureResidency::shared().use(color);
+}
 
-    GLint uvAttrib = glGetAttribLocation(shaderID, "vUV");
-    glBindBuffer(GL_ARRAY_BUFFER, bufferIDs[UV_BUFFER]);
-    glVertexAttribPointer(uvAttrib, 2, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(uvAttrib);
+vec3 Object::center() const
+{
+    return vec3(objectShaderData.WorldFromModel * vec4(0.5f * (lo + hi), 1));
 }
 
-// set shader, textures, etc. for this draw
+// set uniform buffers for this draw
 void Object::setRenderState(GLapp* app, double now)
 {
-    // enable shader
-    glUseProgram(shaderID);
-
-    // select vertex array to render
-    glBindVertexArray(varrayID);
-
-    // bind color texture to active texture #0
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, textureIDs[COLOR_TEXTURE]);
-
     // bind uniform buffers to the appropriate uniform block numbers
-    glBindBufferBase(GL_UNIFORM_BUFFER, 0, app->sceneUniformsID);
-    glBindBufferBase(GL_UNIFORM_BUFFER, 1, bufferIDs[OBJECT_UNIFORM_BUFFER]);
+    // scene & material buffers are only bound for the first draw
+    GLState &gl = GLState::shared();
+    gl.bindBufferBase(GL_UNIFORM_BUFFER, 0, app->sceneUniformsID);
+    app->queue.uniforms.bind(1, uniformOffset, sizeof(ObjectShaderData));
+    gl.bindBufferBase(GL_UNIFORM_BUFFER, 2, app->materialUniformsID);
 }
 
 void Object::draw(GLapp* app, double now)
 {
-    // set shader, textures & uniform buffers
+    // set uniform buffers
     setRenderState(app, now);
 
-    // draw the triangles
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bufferIDs[INDEX_BUFFER]);
-    glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+    // draw this object's range of the mesh triangles
+    glDrawElementsBaseVertex(GL_TRIANGLES, GLsizei(numIndices), GL_UNSIGNED_INT,
+        (void*)(firstIndex * sizeof(unsigned int)), baseVertex);
 }
@@ -1,8 +1,11 @@
 // base class for drawable objects
 #pragma once
 
-#include "Shader.hpp"
+#include "ShaderProgram.hpp"
+#include "MeshBuffer.hpp"
+#include "Texture.hpp"
 #include <glm/glm.hpp>
+#include <memory>
 #include <vector>
 
 //class Ray;
@@ -14,29 +17,47 @@ public:
     // rearrange or pad as necessary for vec4 alignment
     struct ObjectShaderData {
         glm::mat4 WorldFromModel, ModelFromWorld;
-        glm::vec3 Ambient; float pad0;  // ambient color & padding
-        glm::vec3 Diffuse; float pad1;  // diffuse color & padding
-        glm::vec4 Specular;             // specular color (rgb) and exponent (w)
+        unsigned int Material;          // index into MaterialData arrays
+        int ColorArray;                 // TextureArrays entry for color, -1 for ColorTexture
+        int ColorLayer;                 // layer in that array
+        unsigned int pad0;              // padding to vec4 size
     } objectShaderData;
 
-    // arrays defining triangles for GPU
-    unsigned int varrayID;              // GL vertex array object, containing:
+    // arrays defining triangles for GPU, used by initGPUData()
     std::vector<glm::vec3> vert;        //   per-vertex position
     std::vector<glm::vec3> norm;        //   per-vertex normal
     std::vector<glm::vec2> uv;          //   per-vertex texture coordinate
     std::vector<unsigned int> indices;  //   3 vertex indices per triangle
 
-    // GL texture ID(s), array for extensibility to more textures
+    // GPU vertex & index buffers, possibly shared with other objects
+    std::shared_ptr<MeshBuffer> mesh;
+    unsigned int firstIndex;            // range of mesh indices to draw
+    unsigned int numIndices;
+    int baseVertex;                     // added to each index
+    glm::vec3 lo, hi;                   // model-space bounds of the drawn range
+
+    // textures, possibly shared with other objects
+    // array for extensibility to more textures
     enum {COLOR_TEXTURE, NUM_TEXTURES};
-    unsigned int textureIDs[NUM_TEXTURES];
+    std::shared_ptr<Texture> textures[NUM_TEXTURES];
+
+    // offset of this frame's objectShaderData in the RenderQueue uniform ring
+    size_t uniformOffset;
 
-    // GL buffer object IDs
-    enum {OBJECT_UNIFORM_BUFFER, POSITION_BUFFER, NORMAL_BUFFER, UV_BUFFER, INDEX_BUFFER, NUM_BUFFERS};
-    unsigned int bufferIDs[NUM_BUFFERS];
+    // shader features, each a #define in the object shaders
+    enum {
+        HAS_TEXTURE = 1 << 0,           // color texture of its own
+        HAS_TEXTURE_ARRAY = 1 << 1,     // color texture packed in a TextureArray
+        HAS_SPECULAR = 1 << 2,          // material has specular color
+        STATIC_BATCH = 1 << 3,          // material & layer per vertex, see StaticBatch
+        NUM_FEATURES = 4
+    };
 
-    // GL shaders
-    unsigned int shaderID;      // ID for shader program
-    std::vector<ShaderInfo> shaderParts;  // vertex & fragment shader info
+    // GL shaders, shared with other objects using the same program
+    // loaded on first draw, and again whenever the features change
+    std::shared_ptr<ShaderProgram> program;
+    unsigned int programFeatures;       // features program was built with
+    bool batched;                       // drawn as part of a StaticBatch
 
 public:
     // base object constructor: create buffers and textures
@@ -45,21 +66,48 @@ public:
     // virtual destructor to delete any child class data
     virtual ~Object();
 
-    // load an image file into a texture object
-    void loadPPM(const char *imagefile, unsigned int bufferID);
-
     // load GPU data after vert, norm, uv, and indices arrays are full
     void initGPUData();
 
-    // load/reload shaders
+    // draw part of a mesh shared with other objects
+    void initGPUData(std::shared_ptr<MeshBuffer> mesh,
+        unsigned int firstIndex, unsigned int numIndices, int baseVertex);
+
+    // features needed to draw this object now
+    // textures may gain an image or be packed after the first draw
+    virtual unsigned int shaderFeatures(const class GLapp *app) const;
+
+    // choose shader program for programFeatures, loaded once for all objects using it
     virtual void updateShaders();
 
-    // set shader, textures, etc. for this draw
+    // object shader program with these features
+    static std::shared_ptr<ShaderProgram> programFor(unsigned int features);
+
+    // true if the object never moves, so it can be merged into a StaticBatch
+    virtual bool isStatic() const { return true; }
+
+    // append world-space corners of triangles the camera collides with, 3 per triangle
+    // the default uses the vert & indices arrays
+    virtual void collisionTriangles(std::vector<glm::vec3> &corners) const;
+
+    // bind uniform blocks & samplers of an object shader program
+    static void setupProgram(unsigned int programID);
+
+    // update objectShaderData, choose shader variant & make textures resident,
+    // before the draw is queued
+    virtual void prepare(class GLapp *app, double now);
+
+    // world-space center of the bounds, for sorting draws
+    glm::vec3 center() const;
+
+    // bind uniform buffers, etc. for this draw
+    // program, vertex array & color texture are already bound by RenderQueue
     virtual void setRenderState(class GLapp *app, double now);
 
-    // draw this object
+    // draw this object, called by RenderQueue after prepare()
     virtual void draw(class GLapp *app, double now);
     
-    // return t for closest intersection with ray
-    virtual const float intersect(const glm::vec3 rayStart, const glm::vec3 rayDir, const float near) const = 0;
+    // return t for closest intersection with ray in [tmin, tmax], infinity if none
+    virtual const float intersect(const glm::vec3 rayStart, const glm::vec3 rayDir,
+        const float tmin, const float tmax) const = 0;
 };
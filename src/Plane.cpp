@@ -3,6 +3,7 @@
 #include "Plane.hpp"
 #include "GLapp.hpp"
 
+#include <math.h>
 #include <stdio.h>
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
@@ -11,7 +12,8 @@ using namespace glm;  // avoid glm:: for all glm types and functions
 
 // load the sphere data
 Plane::Plane(vec3 size, const char *texturePPM) :
-    Object(texturePPM)
+    Object(texturePPM),
+    packets(nullptr), numPackets(0)
 {
     // build texture coordinate, normal, and vertex arrays
     uv = {vec2(0.f,0.f), vec2(1.f,0.f), vec2(0.f,1.f), vec2(1.f,1.f)};
@@ -30,62 +32,52 @@ Plane::Plane(vec3 size, const char *texturePPM) :
 }
 
 // Object overload to draw external objects
-Plane::Plane(std::vector<glm::vec3> vVert, std::vector<glm::vec3> vnVert,
-    std::vector<glm::vec2> vtVert, std::vector<unsigned int> fVert, const char* texturePPM) :
-    Object(texturePPM)
+Plane::Plane(std::shared_ptr<MeshCache> meshCache, std::shared_ptr<MeshBuffer> mesh,
+    const MeshCache::Group &group, unsigned int material) :
+    Object(meshCache->string(meshCache->materials()[group.material].textureOffset)),
+    cache(meshCache)
 {
-    // build texture coordinate, normal, and vertex arrays
-    uv = vtVert;
-    norm = vnVert;
-    vert = vVert;
+    // intersection data used in place
+    const MeshCache::Header &header = cache->header();
+    packets = cache->array<TrianglePacket>(header.packetOffset) + group.firstPacket;
+    numPackets = group.numPackets;
+
+    // bounds of this group, for sorting draws
+    const vec3 *vert = cache->array<vec3>(header.vertOffset);
+    const unsigned int *index = cache->array<unsigned int>(header.indexOffset) + group.firstIndex;
+    if (group.numIndices) lo = hi = vert[index[0] + group.baseVertex];
+    for (uint32_t i = 0; i < group.numIndices; ++i) {
+        lo = min(lo, vert[index[i] + group.baseVertex]);
+        hi = max(hi, vert[index[i] + group.baseVertex]);
+    }
 
-    // build index array linking sets of three vertices into triangles
-    indices = fVert;
+    // draw this group's part of the model
+    objectShaderData.Material = material;
+    initGPUData(mesh, group.firstIndex, group.numIndices, group.baseVertex);
+}
 
-    // intersection precomputation
-    for (int i = 0; i < vVert.size() - 2; i += 3) {
-        int j = i + 1, k = i + 2;
-        vec3 e0 = vVert[j] - vVert[k];
-        vec3 e1 = vVert[k] - vVert[i];
-        vec3 e2 = vVert[i] - vVert[j];
-        vec3 currN = normalize(cross(e0, e1));
-        N.push_back(currN);
-        vec3 currNa = cross(currN, e0);         vec3 currNb = cross(currN, e1);
-        currNa = currNa / dot(currNa, e2);      currNb = currNb / dot(currNb, e0);
-        Na.push_back(currNa);                   Nb.push_back(currNb);
-        float currCa = dot(currNa, vVert[j]); float currCb = dot(currNb, vVert[k]);
-        Ca.push_back(currCa);                   Cb.push_back(currCb);
-        V0_dot_N.push_back(dot(vVert[i], currN));
+// world-space corners of this group's triangles
+void Plane::collisionTriangles(std::vector<vec3> &corners) const
+{
+    if (!cache) {
+        Object::collisionTriangles(corners);
+        return;
     }
-
-    initGPUData();
+    const MeshCache::Header &header = cache->header();
+    const vec3 *vert = cache->array<vec3>(header.vertOffset);
+    const unsigned int *index = cache->array<unsigned int>(header.indexOffset) + firstIndex;
+    for (unsigned int i = 0; i < numIndices / 3 * 3; ++i)
+        corners.push_back(vec3(objectShaderData.WorldFromModel * vec4(vert[index[i] + baseVertex], 1)));
 }
 
 const float
-Plane::intersect(const vec3 rayStart, const vec3 rayDir, const float near) const
+Plane::intersect(const vec3 rayStart, const vec3 rayDir, const float tmin, const float tmax) const
 {
-    // value outside range for movement bounding and z-axis adjustment
-    float noIsect = 800;
-
-    for (int i = 0; i < N.size(); i++) {
-        // compute intersection point with plane
-        float t = (V0_dot_N[i] - dot(N[i], rayStart)) / dot(N[i], rayDir);
-
-        if (t < near || t > 750)
-            return noIsect;  // not in ray bounds: no intersection
-
-        vec3 P = rayStart + rayDir * t;
-
-        // compute barycentric alpha
-        float a = dot(Na[i], P) - Ca[i];
-        if (a < 0 || a > 1)
-            return noIsect;  // outside 1st edge or past 1st vertex
-
-        // compute barycentric beta
-        float b = dot(Nb[i], P) - Cb[i];
-        if (b < 0 || 1 - a - b < 0)
-            return noIsect;  // outside 2nd or 3rd edge
-
-        return t;
-    }
+    // closest hit over all triangles, eight at a time
+    float tClosest = tmax;
+    bool found = false;
+    for (size_t i = 0; i < numPackets; i++)
+        if (packets[i].intersect(rayStart, rayDir, tmin, tClosest) >= 0)
+            found = true;
+    return found ? tClosest : INFINITY;
 }
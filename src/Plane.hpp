@@ -2,22 +2,30 @@
 #pragma once
 
 #include "Object.hpp"
+#include "MeshCache.hpp"
+#include "TrianglePacket.hpp"
+
+#include <memory>
 
 // plane object
 class Plane : public Object {
 private:
-    std::vector<glm::vec3> N, Na, Nb;         // edge normals
-    std::vector<float> Ca, Cb;        // constants for barycentric computation
-    std::vector<float> V0_dot_N;      // derived for intersection testing
+    // precomputed intersection data for this group's triangles, stored in the mesh cache
+    std::shared_ptr<MeshCache> cache;   // keeps packets alive
+    const TrianglePacket *packets;
+    size_t numPackets;
 
 public:
     // create plane from -size/2 to size/2
     Plane(glm::vec3 size, const char *texturePPM);
 
-    // create objects from .obj files
-    Plane(std::vector<glm::vec3> vVert, std::vector<glm::vec3> vnVert,
-        std::vector<glm::vec2> vtVert, std::vector<unsigned int> fVert, const char* texturePPM);
+    // create object from one material group of a cached .obj file
+    // mesh holds the GPU copy of the whole model, material is a scene material ID
+    Plane(std::shared_ptr<MeshCache> cache, std::shared_ptr<MeshBuffer> mesh,
+        const MeshCache::Group &group, unsigned int material);
 
 public: // object functions
-    const float intersect(const glm::vec3 rayStart, const glm::vec3 rayDir, const float near) const override;
+    void collisionTriangles(std::vector<glm::vec3> &corners) const override;
+    const float intersect(const glm::vec3 rayStart, const glm::vec3 rayDir,
+        const float tmin, const float tmax) const override;
 };
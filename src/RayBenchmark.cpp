@@ -0,0 +1,176 @@
+// ray query timing on a loaded model, run when built with GLAPP_RAY_BENCHMARK
+
+#include "RayBenchmark.hpp"
+#include "BVH.hpp"
+#include "Object.hpp"
+
+#include <GLFW/glfw3.h>
+
+#include <math.h>
+#include <random>
+#include <stdio.h>
+
+using namespace glm;  // avoid glm:: for all glm types and functions
+
+// rays timed with each method, scanning is far slower
+// KERNEL_RAYS are tested against every packet with both packet kernels
+enum { SCAN_RAYS = 1000, BVH_RAYS = 100000, KERNEL_RAYS = 100 };
+
+// range of every ray, as far as the camera looks for floor
+static const float FAR = 750;
+
+// sweeps are the camera's sphere making one 60 Hz frame of horizontal movement
+static const float CAMERA_RADIUS = 250, CAMERA_STEP = 500 * 3.14159265f / 60;
+
+// closest point to p on triangle abc, by which region of the triangle p projects to
+static vec3 closestPoint(vec3 p, vec3 a, vec3 b, vec3 c)
+{
+    vec3 ab = b - a, ac = c - a, ap = p - a;
+    float d1 = dot(ab, ap), d2 = dot(ac, ap);
+    if (d1 <= 0 && d2 <= 0) return a;
+    vec3 bp = p - b;
+    float d3 = dot(ab, bp), d4 = dot(ac, bp);
+    if (d3 >= 0 && d4 <= d3) return b;
+    float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0 && d1 >= 0 && d3 <= 0) return a + ab * (d1 / (d1 - d3));
+    vec3 cp = p - c;
+    float d5 = dot(ab, cp), d6 = dot(ac, cp);
+    if (d6 >= 0 && d5 <= d6) return c;
+    float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0 && d2 >= 0 && d6 <= 0) return a + ac * (d2 / (d2 - d6));
+    float va = d3 * d6 - d5 * d4;
+    if (va <= 0 && d4 - d3 >= 0 && d5 - d6 >= 0) return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+    float denom = 1 / (va + vb + vc);
+    return a + ab * (vb * denom) + ac * (vc * denom);
+}
+
+void rayBenchmark(const char *name, const std::vector<Object*> &objects)
+{
+    std::vector<vec3> corners;
+    for (const Object *object : objects)
+        object->collisionTriangles(corners);
+    BVH bvh;
+    bvh.build(corners);
+    if (bvh.empty()) return;
+
+    // origins inside the model bounds, directions uniform over the sphere
+    // a fixed seed so runs are comparable
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> unit(0, 1);
+    std::normal_distribution<float> gauss;
+    vec3 lo = bvh.nodes[0].lo, hi = bvh.nodes[0].hi;
+    std::vector<vec3> start(BVH_RAYS), dir(BVH_RAYS);
+    for (size_t i = 0; i < BVH_RAYS; ++i) {
+        start[i] = lo + (hi - lo) * vec3(unit(random), unit(random), unit(random));
+        dir[i] = normalize(vec3(gauss(random), gauss(random), gauss(random)));
+    }
+
+    // per-object scan, as the camera used to
+    std::vector<float> scanT(SCAN_RAYS);
+    double scanStart = glfwGetTime();
+    for (size_t i = 0; i < SCAN_RAYS; ++i) {
+        float t = INFINITY;
+        for (const Object *object : objects)
+            t = min(t, object->intersect(start[i], dir[i], 0, FAR));
+        scanT[i] = t;
+    }
+    double scanTime = (glfwGetTime() - scanStart) / SCAN_RAYS;
+
+    unsigned int hits = 0, differ = 0;
+    double bvhStart = glfwGetTime();
+    for (size_t i = 0; i < BVH_RAYS; ++i) {
+        BVH::Hit hit;
+        bool found = bvh.closest(start[i], dir[i], 0, FAR, hit);
+        if (found) ++hits;
+        if (i < SCAN_RAYS) {
+            float t = found ? hit.t : INFINITY;
+            if (t != scanT[i] && !(fabsf(t - scanT[i]) <= 1e-4f * max(1.f, t)))
+                ++differ;
+        }
+    }
+    double bvhTime = (glfwGetTime() - bvhStart) / BVH_RAYS;
+
+    // camera collision, from the same starts in each ray's horizontal direction
+    // models smaller than the camera get a sphere & step scaled to their size
+    float diagonal = length(hi - lo);
+    float radius = min(CAMERA_RADIUS, 0.02f * diagonal), step = min(CAMERA_STEP, 0.01f * diagonal);
+    std::vector<vec3> move(BVH_RAYS);
+    for (size_t i = 0; i < BVH_RAYS; ++i)
+        move[i] = step * normalize(vec3(dir[i].x, dir[i].y, 0));
+    std::vector<BVH::Contact> contacts(BVH_RAYS);
+    std::vector<bool> touched(BVH_RAYS);
+    unsigned int numTouched = 0;
+    double sweepStart = glfwGetTime();
+    for (size_t i = 0; i < BVH_RAYS; ++i)
+        if (bvh.sweep(start[i], radius, move[i], contacts[i])) {
+            touched[i] = true;
+            ++numTouched;
+        }
+    double sweepTime = (glfwGetTime() - sweepStart) / BVH_RAYS;
+
+    // same sweeps against every triangle, and contacts checked to be radius from their triangle
+    // sweeps starting inside a triangle's reach stop at t = 0 without touching distance
+    unsigned int sweepDiffer = 0, offSurface = 0;
+    double scanSweepStart = glfwGetTime();
+    for (size_t i = 0; i < SCAN_RAYS; ++i) {
+        float t = 1;
+        vec3 normal;
+        bool hit = false;
+        for (size_t c = 0; c + 2 < corners.size(); c += 3)
+            if (BVH::sweepTriangle(corners[c], corners[c + 1], corners[c + 2], start[i], radius, move[i], t, normal))
+                hit = true;
+        if (hit != touched[i] || (hit && t != contacts[i].t))
+            ++sweepDiffer;
+    }
+    double scanSweepTime = (glfwGetTime() - scanSweepStart) / SCAN_RAYS;
+    for (size_t i = 0; i < SCAN_RAYS; ++i) {
+        if (!touched[i] || contacts[i].t == 0) continue;
+        const vec3 *v = &corners[3 * contacts[i].triangle];
+        vec3 center = start[i] + move[i] * contacts[i].t;
+        if (fabsf(length(center - closestPoint(center, v[0], v[1], v[2])) - radius) > 1e-3f * radius)
+            ++offSurface;
+    }
+
+    // SIMD packet test against the scalar reference
+    size_t tests = KERNEL_RAYS * bvh.packets.size();
+    std::vector<float> kernelT(tests), scalarT(tests);
+    std::vector<int> kernelLane(tests), scalarLane(tests);
+    double kernelStart = glfwGetTime();
+    for (size_t i = 0, k = 0; i < KERNEL_RAYS; ++i)
+        for (size_t p = 0; p < bvh.packets.size(); ++p, ++k) {
+            kernelT[k] = FAR;
+            kernelLane[k] = bvh.packets[p].intersect(start[i], dir[i], 0, kernelT[k]);
+        }
+    double kernelTime = (glfwGetTime() - kernelStart) / tests;
+    double scalarStart = glfwGetTime();
+    for (size_t i = 0, k = 0; i < KERNEL_RAYS; ++i)
+        for (size_t p = 0; p < bvh.packets.size(); ++p, ++k) {
+            scalarT[k] = FAR;
+            scalarLane[k] = bvh.packets[p].intersectScalar(start[i], dir[i], 0, scalarT[k]);
+        }
+    double scalarTime = (glfwGetTime() - scalarStart) / tests;
+    unsigned int inexact = 0, laneDiffer = 0;
+    float maxError = 0;
+    for (size_t k = 0; k < tests; ++k) {
+        if (kernelLane[k] != scalarLane[k]) ++laneDiffer;
+        else if (kernelT[k] != scalarT[k]) {
+            ++inexact;
+            maxError = max(maxError, fabsf(kernelT[k] - scalarT[k]) / max(1.f, scalarT[k]));
+        }
+    }
+
+    printf("%s: %zu triangles, %zu BVH nodes, depth %u, built in %.2f ms\n",
+        name, bvh.numTriangles, bvh.nodes.size(), bvh.depth, 1000 * bvh.buildTime);
+    printf("%s: closest hit %.3f us/ray scanning objects, %.3f us/ray with BVH (%.0fx), "
+        "%.0f%% hit, %u of %u differ\n",
+        name, 1e6 * scanTime, 1e6 * bvhTime, scanTime / bvhTime,
+        100. * hits / BVH_RAYS, differ, unsigned(SCAN_RAYS));
+    printf("%s: sweeps of radius %g by %g, %.3f us/sweep scanning triangles, %.3f us/sweep with BVH, "
+        "%.0f%% in contact, %u of %u differ, %u contacts off the surface\n",
+        name, radius, step, 1e6 * scanSweepTime, 1e6 * sweepTime,
+        100. * numTouched / BVH_RAYS, sweepDiffer, unsigned(SCAN_RAYS), offSurface);
+    printf("%s: packet of %d triangles %.2f ns %s, %.2f ns scalar (%.1fx), "
+        "%zu tests: %u hit different lanes, %u inexact by up to %g\n",
+        name, int(TrianglePacket::WIDTH), 1e9 * kernelTime, TrianglePacket::kernel(), 1e9 * scalarTime,
+        scalarTime / kernelTime, tests, laneDiffer, inexact, maxError);
+}
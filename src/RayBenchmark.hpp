@@ -0,0 +1,9 @@
+// ray query timing on a loaded model, run when built with GLAPP_RAY_BENCHMARK
+#pragma once
+
+#include <vector>
+
+// time random rays against objects, scanning each object's triangles and
+// through a BVH over all of them, and print the cost per query
+// also reports rays where the two disagree
+void rayBenchmark(const char *name, const std::vector<class Object*> &objects);
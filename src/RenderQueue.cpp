@@ -0,0 +1,130 @@
+// draws sorted by GL state, so shared state is bound once per run
+
+#include "RenderQueue.hpp"
+#include "GLapp.hpp"
+#include "GLState.hpp"
+#include "Object.hpp"
+#include "TextureArray.hpp"
+#include "TextureCache.hpp"
+#include "TextureResidency.hpp"
+
+#include <GL/glew.h>
+
+#include <algorithm>
+#include <stdio.h>
+
+using namespace glm;  // avoid glm:: for all glm types and functions
+
+// key fields, high to low
+enum {
+    PROGRAM_BITS = 14, TEXTURE_BITS = 18, VARRAY_BITS = 14, DEPTH_BITS = 18,
+    DEPTH_SHIFT = 0,
+    VARRAY_SHIFT = DEPTH_SHIFT + DEPTH_BITS,
+    TEXTURE_SHIFT = VARRAY_SHIFT + VARRAY_BITS,
+    PROGRAM_SHIFT = TEXTURE_SHIFT + TEXTURE_BITS
+};
+
+// GL names are small integers, so masking rarely merges two
+static inline uint64_t field(unsigned int value, int bits, int shift)
+{
+    return (uint64_t(value) & ((uint64_t(1) << bits) - 1)) << shift;
+}
+
+uint64_t RenderQueue::sortKey(const Object &object, vec3 eye, float far)
+{
+    // packed textures are bound for the whole scene, so they sort together
+    const Texture &color = *object.textures[Object::COLOR_TEXTURE];
+    unsigned int texture = color.array ? 0 : color.textureID;
+
+    float distance = length(object.center() - eye) / max(far, 1.f);
+    unsigned int depth = unsigned(clamp(distance, 0.f, 1.f) * float((1 << DEPTH_BITS) - 1));
+
+    return field(object.program->programID, PROGRAM_BITS, PROGRAM_SHIFT)
+        | field(texture, TEXTURE_BITS, TEXTURE_SHIFT)
+        | field(object.mesh->varrayID, VARRAY_BITS, VARRAY_SHIFT)
+        | field(depth, DEPTH_BITS, DEPTH_SHIFT);
+}
+
+void RenderQueue::sort()
+{
+    auto byKey = [](const Draw &a, const Draw &b) { return a.key < b.key; };
+
+    // few out-of-order neighbors: insertion sort is close to linear
+    size_t descents = 0;
+    for (size_t i = 1; i < draws.size(); ++i)
+        if (draws[i].key < draws[i - 1].key) ++descents;
+    if (descents == 0) return;
+    if (descents > draws.size() / 16) {
+        std::sort(draws.begin(), draws.end(), byKey);
+        return;
+    }
+    for (size_t i = 1; i < draws.size(); ++i) {
+        Draw draw = draws[i];
+        size_t j = i;
+        for (; j > 0 && byKey(draw, draws[j - 1]); --j)
+            draws[j] = draws[j - 1];
+        draws[j] = draw;
+    }
+}
+
+void RenderQueue::draw(GLapp *app, double now)
+{
+    // merge static objects once textures are in and packed
+    if (!batch.baked && numObjects && !TextureCache::shared().isLoading()) {
+        batch.bake(app);
+        numObjects = 0;
+    }
+
+    // start over if objects were added or removed
+    if (numObjects != app->objects.size()) {
+        draws.clear();
+        for (Object *object : app->objects)
+            if (!object->batched)
+                draws.push_back({0, object});
+        numObjects = app->objects.size();
+    }
+
+    // the ring binds through the tracker, so last frame's state must not skip it
+    GLState &gl = GLState::shared();
+    gl.beginFrame();
+
+    // this frame's object data & keys, by distance from the camera
+    vec3 eye(app->camPos[0], app->camPos[1], app->camPos[2]);
+    uniforms.beginFrame(draws.size() + batch.batches.size(), sizeof(Object::ObjectShaderData));
+    for (Draw &draw : draws) {
+        Object &object = *draw.object;
+        object.prepare(app, now);
+        object.uniformOffset = uniforms.write(&object.objectShaderData, sizeof(Object::ObjectShaderData));
+        draw.key = sortKey(object, eye, app->far);
+    }
+    for (StaticBatch::Batch &b : batch.batches) {
+        if (b.array)
+            TextureResidency::shared().use(*b.array);
+        b.uniformOffset = uniforms.write(&b.objectShaderData, sizeof(Object::ObjectShaderData));
+    }
+    uniforms.unmap();
+    sort();
+
+    // texture residency & prepare() bind textures with GL directly
+    gl.invalidate();
+
+    // binds matching the previous draw are skipped
+    for (Draw &draw : draws) {
+        Object &object = *draw.object;
+        gl.useProgram(object.program->programID);
+        gl.bindVertexArray(object.mesh->varrayID);
+        const Texture &color = *object.textures[Object::COLOR_TEXTURE];
+        if (!color.array)
+            gl.bindTexture(0, GL_TEXTURE_2D, color.textureID);
+
+        object.draw(app, now);
+    }
+    batch.draw(app);
+    uniforms.endFrame();
+
+    // report when sorting results change, not every frame
+    if (gl.issued != lastIssued) {
+        printf("%zu draws + %zu batched: %u GL state calls, %u skipped\n", draws.size(), batch.batches.size(), gl.issued, gl.elided);
+        lastIssued = gl.issued;
+    }
+}
@@ -0,0 +1,52 @@
+// draws sorted by GL state, so shared state is bound once per run
+//
+// Each draw gets a 64-bit key: shader program in the high bits, then
+// color texture, then vertex array, then a front-to-back depth bucket.
+// Sorting by key groups draws that share state, and within a group draws
+// near ones first. Draw order changes little between frames, so the last
+// frame's order is kept and only fixed up. Binds go through GLState,
+// which skips any that match the previous draw. Object uniform blocks
+// for the whole frame go in one ring buffer, bound by range per draw.
+// Once textures finish loading, static objects are merged into a
+// StaticBatch and leave the queue.
+#pragma once
+
+#include "StaticBatch.hpp"
+#include "UniformRing.hpp"
+#include <glm/glm.hpp>
+#include <stdint.h>
+#include <vector>
+
+class RenderQueue {
+public:
+    struct Draw {
+        uint64_t key;               // sort key
+        class Object *object;       // object to draw
+    };
+
+private:
+    std::vector<Draw> draws;        // in last frame's order
+    size_t numObjects;              // app objects when draws was built
+
+    unsigned int lastIssued;        // GL state calls issued last frame, see GLState
+
+public:
+    // per-object uniform blocks, written for all draws before any are issued
+    UniformRing uniforms;
+
+    // static objects drawn together instead of through draws
+    StaticBatch batch;
+
+    RenderQueue() : numObjects(0), lastIssued(0) {}
+
+    // sort and draw all objects in app
+    void draw(class GLapp *app, double now);
+
+    // key for an object already prepared for this frame
+    // eye is the world-space view position
+    static uint64_t sortKey(const class Object &object, glm::vec3 eye, float far);
+
+private:
+    // restore key order, cheaply when few draws moved
+    void sort();
+};
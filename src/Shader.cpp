@@ -11,6 +11,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <stdio.h>
+#include <string.h>
 #include <assert.h>
 
 #ifdef _WIN32
@@ -18,12 +19,9 @@
 #pragma warning( disable: 4996 )
 #endif
 
-// load and compile a single shader
-// id is an existing shader object
-// shader type is defined by shader object type
-bool loadShader(unsigned int id, const char *file)
+// read a shader file from the data directory
+bool readShader(const char *file, std::vector<char> &source)
 {
-    // read entire file
     std::filesystem::path path = std::filesystem::path(PROJECT_DATA_DIR) / file;
 #ifdef WIN32
     struct _stat statbuf;
@@ -32,21 +30,41 @@ bool loadShader(unsigned int id, const char *file)
     struct stat statbuf;
     int ok = stat(path.string().c_str(), &statbuf);
 #endif
-    assert(ok != -1);
-
-    // feed shader to OpenGL as an array of blocks of code with a parallel array of sizes
-    // we're using one block with the entire code file.
-    int shaderBlockSizes[] = {int(statbuf.st_size)};
-    std::vector<GLchar> shader(shaderBlockSizes[0]);
-    GLchar *shaderBlocks[] = {shader.data()};
+    FILE *f = ok != -1 ? fopen(path.string().c_str(), "rb") : nullptr;
+    if (!f) {
+        fprintf(stderr, "can't open shader %s\n", path.string().c_str());
+        return false;
+    }
 
-    FILE *f = fopen(path.string().c_str(), "rb");
-    assert(f);
-    fread(shaderBlocks[0], 1, shaderBlockSizes[0], f);
+    source.resize(statbuf.st_size);
+    fread(source.data(), 1, source.size(), f);
     fclose(f);
+    return true;
+}
+
+// load and compile a single shader
+// id is an existing shader object
+// shader type is defined by shader object type
+bool loadShader(unsigned int id, const char *file, const char *defines)
+{
+    // read entire file
+    std::vector<GLchar> shader;
+    if (!readShader(file, shader)) return false;
+
+    // #version must come first, so split after it
+    int versionSize = 0;
+    if (shader.size() > 8 && strncmp(shader.data(), "#version", 8) == 0)
+        while (versionSize < int(shader.size()) && shader[versionSize++] != '\n');
+
+    // feed shader to OpenGL as an array of blocks of code with a parallel array of sizes:
+    // version line, defines, then the rest of the file, numbered as in the file
+    const char *lineReset = versionSize ? "#line 2\n" : "";
+    const GLchar *shaderBlocks[] = {shader.data(), defines, lineReset, shader.data() + versionSize};
+    int shaderBlockSizes[] = {versionSize, int(strlen(defines)), int(strlen(lineReset)),
+        int(shader.size()) - versionSize};
 
     // compile as shader
-    glShaderSource(id, 1, shaderBlocks, shaderBlockSizes);
+    glShaderSource(id, 4, shaderBlocks, shaderBlockSizes);
     glCompileShader(id);
 
     // was compile successful?
@@ -70,11 +88,11 @@ bool loadShader(unsigned int id, const char *file)
 
 
 // load a set of shaders
-bool loadShaders(unsigned int progID, std::vector<ShaderInfo> &components)
+bool loadShaders(unsigned int progID, std::vector<ShaderInfo> &components, const char *defines)
 {
     // load shader code
     for(auto shader : components) {
-        if (! loadShader(shader.id, shader.file)) return false; // bail on error
+        if (! loadShader(shader.id, shader.file, defines)) return false; // bail on error
     }
 
     // link shader programs
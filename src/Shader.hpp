@@ -9,13 +9,20 @@ struct ShaderInfo {
     const char *file;           // file to load into this object
 };
 
+// read entire shader file from the data directory into source
+// return false with a message if it can't be read
+bool readShader(const char *file, std::vector<char> &source);
+
 // load shader from file into id = existing shader object
 // shader type is defined by shader object type
+// defines are #define lines, inserted after the file's #version line
 // return false on compile error
-bool loadShader(unsigned int id, const char *file);
+bool loadShader(unsigned int id, const char *file, const char *defines = "");
 
 // load a set of shaders
 // progID is the program object
 // components[numComponents] is a list of shader components to link
+// defines are added to every component
 // return false on compile error
-bool loadShaders(unsigned int progID, std::vector<ShaderInfo> &components);
+bool loadShaders(unsigned int progID, std::vector<ShaderInfo> &components,
+    const char *defines = "");
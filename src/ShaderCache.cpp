@@ -0,0 +1,54 @@
+// process-wide cache sharing one linked program per shader set
+
+#include "ShaderCache.hpp"
+
+#include <GLFW/glfw3.h>
+
+#include <stdio.h>
+
+std::shared_ptr<ShaderProgram> ShaderCache::get(const char *vertFile, const char *fragFile,
+    const std::string &defines, void (*setup)(unsigned int))
+{
+    std::weak_ptr<ShaderProgram> &entry = programs[std::string(vertFile) + "|" + fragFile + "|" + defines];
+    std::shared_ptr<ShaderProgram> program = entry.lock();
+    if (program) {
+        ++hits;
+        return program;
+    }
+
+    program = std::make_shared<ShaderProgram>(vertFile, fragFile, defines, setup);
+    load(*program);
+    entry = program;
+    return program;
+}
+
+void ShaderCache::reload()
+{
+    unsigned int reloaded = 0, failed = failures;
+    for (auto entry = programs.begin(); entry != programs.end(); ) {
+        std::shared_ptr<ShaderProgram> program = entry->second.lock();
+        if (!program) {
+            entry = programs.erase(entry);
+            continue;
+        }
+        load(*program);
+        ++reloaded;
+        ++entry;
+    }
+    printf("%u shader programs reloaded, %u failed\n", reloaded, failures - failed);
+}
+
+void ShaderCache::load(ShaderProgram &program)
+{
+    double start = glfwGetTime();
+    if (!program.load()) ++failures;
+    else if (program.fromBinary) ++binaries;
+    else ++compiles;
+    loadTime += glfwGetTime() - start;
+}
+
+ShaderCache &ShaderCache::shared()
+{
+    static ShaderCache cache;
+    return cache;
+}
@@ -0,0 +1,42 @@
+// process-wide cache sharing one linked program per shader set
+//
+// Programs are keyed by shader files and defines, compiled on first use,
+// and shared by every object asking for the same set. Entries expire when
+// the last object using the program goes away.
+#pragma once
+
+#include "ShaderProgram.hpp"
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+class ShaderCache {
+private:
+    std::unordered_map<std::string, std::weak_ptr<ShaderProgram>> programs;
+
+public:
+    // statistics since startup
+    unsigned int compiles;      // programs compiled & linked, including reloads
+    unsigned int binaries;      // programs loaded from the binary cache instead
+    unsigned int hits;          // requests served by an existing program
+    unsigned int failures;      // loads that failed to compile or link, including reloads
+    double loadTime;            // seconds spent loading programs
+
+public:
+    ShaderCache() : compiles(0), binaries(0), hits(0), failures(0), loadTime(0) {}
+
+    // program for this shader set, compiling it if it's new
+    // setup is only used when the program is created
+    std::shared_ptr<ShaderProgram> get(const char *vertFile, const char *fragFile,
+        const std::string &defines = "", void (*setup)(unsigned int programID) = nullptr);
+
+    // recompile each program in use once, e.g. after editing shader files
+    void reload();
+
+    // cache used by all objects, must be used from the GL thread
+    static ShaderCache &shared();
+
+private:
+    // load program, updating statistics
+    void load(ShaderProgram &program);
+};
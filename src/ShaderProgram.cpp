@@ -0,0 +1,122 @@
+// linked GL shader program, shared by everything drawn with the same shaders
+
+#include "ShaderProgram.hpp"
+#include "CacheFile.hpp"
+#include "GLState.hpp"
+#include "MappedFile.hpp"
+
+#include <GL/glew.h>
+
+#include <stdio.h>
+#include <string.h>
+
+ShaderProgram::ShaderProgram(const char *vertFile, const char *fragFile,
+    const std::string &defines, void (*setup)(unsigned int)) :
+    defines(defines), setup(setup), fromBinary(false)
+{
+    parts = {
+        {glCreateShader(GL_VERTEX_SHADER  ), vertFile},
+        {glCreateShader(GL_FRAGMENT_SHADER), fragFile}
+    };
+    programID = glCreateProgram();
+
+    // ask the driver to keep the binary, for saveBinary
+    glProgramParameteri(programID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+ShaderProgram::~ShaderProgram()
+{
+    for (auto shader : parts)
+       glDeleteShader(shader.id);
+    glDeleteProgram(programID);
+}
+
+bool ShaderProgram::load()
+{
+    uint64_t key = binaryKey();
+    fromBinary = key && loadBinary(key);
+    if (!fromBinary) {
+        if (!loadShaders(programID, parts, defines.c_str())) {
+            // a rejected binary has already replaced the last good program
+            GLint linked = 0;
+            glGetProgramiv(programID, GL_LINK_STATUS, &linked);
+            if (!linked)
+                fprintf(stderr, "no linked program left for %s + %s\n", parts[0].file, parts[1].file);
+            return false;
+        }
+        if (key) saveBinary(key);
+    }
+
+    GLState::shared().useProgram(programID);
+    if (setup) setup(programID);
+    return true;
+}
+
+std::string ShaderProgram::binaryPath() const
+{
+    // named for the fragment shader plus a hash of the file & define set
+    uint64_t hash = 14695981039346656037ull;
+    for (auto shader : parts)
+        hash = hashBytes(shader.file, strlen(shader.file) + 1, hash);
+    hash = hashBytes(defines.data(), defines.size(), hash);
+
+    char extension[32];
+    snprintf(extension, sizeof(extension), "-%016llx.program", (unsigned long long)hash);
+    return cacheFileFor(parts.back().file, extension).u8string();
+}
+
+uint64_t ShaderProgram::binaryKey() const
+{
+    uint64_t key = 14695981039346656037ull;
+    std::vector<char> source;
+    for (auto shader : parts) {
+        if (!readShader(shader.file, source)) return 0;
+        key = hashBytes(source.data(), source.size(), key);
+    }
+    key = hashBytes(defines.data(), defines.size() + 1, key);
+
+    // binaries only load on the driver that made them
+    for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+        const char *value = (const char*)glGetString(name);
+        if (value) key = hashBytes(value, strlen(value) + 1, key);
+    }
+    return key ? key : 1;
+}
+
+bool ShaderProgram::loadBinary(uint64_t key)
+{
+    MappedFile file(binaryPath().c_str());
+    if (!file.isOpen() || file.size < sizeof(BinaryHeader)) return false;
+
+    const BinaryHeader &head = *(const BinaryHeader*)file.data;
+    if (memcmp(head.magic, "GLPB", 4) != 0 || head.version != VERSION || head.key != key
+        || file.size != sizeof(BinaryHeader) + head.size)
+        return false;
+
+    // driver may still reject it, e.g. after an update with the same version string
+    glProgramBinary(programID, head.format, file.data + sizeof(BinaryHeader), GLsizei(head.size));
+    GLint success;
+    glGetProgramiv(programID, GL_LINK_STATUS, &success);
+    if (!success)
+        fprintf(stderr, "cached binary for %s + %s rejected, compiling\n", parts[0].file, parts[1].file);
+    return success;
+}
+
+void ShaderProgram::saveBinary(uint64_t key) const
+{
+    GLint size = 0;
+    glGetProgramiv(programID, GL_PROGRAM_BINARY_LENGTH, &size);
+    if (size <= 0) return;     // driver doesn't support binaries
+
+    std::vector<char> data(sizeof(BinaryHeader) + size);
+    BinaryHeader &head = *(BinaryHeader*)data.data();
+    memcpy(head.magic, "GLPB", 4);
+    head.version = VERSION;
+    head.key = key;
+    head.size = uint32_t(size);
+
+    GLenum format;
+    glGetProgramBinary(programID, size, nullptr, &format, data.data() + sizeof(BinaryHeader));
+    head.format = format;
+    writeCacheFile(binaryPath(), data.data(), data.size());
+}
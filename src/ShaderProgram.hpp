@@ -0,0 +1,66 @@
+// linked GL shader program, shared by everything drawn with the same shaders
+//
+// Linked programs are saved with glGetProgramBinary in PROJECT_CACHE_DIR,
+// keyed by a hash of the shader sources, defines and GL driver. Later runs
+// load the binary instead of compiling, unless anything in the key changed
+// or the driver rejects it.
+#pragma once
+
+#include "Shader.hpp"
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+class ShaderProgram {
+public:
+    unsigned int programID;         // GL program object
+    std::vector<ShaderInfo> parts;  // vertex & fragment shader info
+    std::string defines;            // #define lines added to every part
+
+    // program state that doesn't survive relinking, set after each load
+    // e.g. uniform block bindings and sampler units
+    void (*setup)(unsigned int programID);
+
+    bool fromBinary;                // last load used the binary cache
+
+    // start of binary cache file, followed by the program binary
+    enum { VERSION = 1 };
+    struct BinaryHeader {
+        char magic[4];              // "GLPB"
+        uint32_t version;           // VERSION
+        uint64_t key;               // hash of sources, defines & driver
+        uint32_t format;            // from glGetProgramBinary
+        uint32_t size;              // bytes of binary
+    };
+
+public:
+    // create program & shader objects, without compiling
+    ShaderProgram(const char *vertFile, const char *fragFile, const std::string &defines,
+        void (*setup)(unsigned int programID));
+
+    // free GL program & shaders
+    ~ShaderProgram();
+
+    // program owns its GL objects, so no copies
+    ShaderProgram(const ShaderProgram &) = delete;
+    ShaderProgram &operator=(const ShaderProgram &) = delete;
+
+    // load from the binary cache, or compile & link from the shader files
+    // and update the cache, then run setup
+    // returns false with a message on error, keeping the last good program
+    // unless a rejected binary already replaced it, which is also reported
+    bool load();
+
+private:
+    // binary cache file for this program, one per file & define set
+    std::string binaryPath() const;
+
+    // hash of everything the binary depends on, 0 if a source is missing
+    uint64_t binaryKey() const;
+
+    // load a cached binary matching key, false if none or rejected
+    bool loadBinary(uint64_t key);
+
+    // save the linked program under key
+    void saveBinary(uint64_t key) const;
+};
@@ -59,16 +59,12 @@ Sphere::Sphere(int w, int h, vec3 size, const char *texturePPM) :
 //
 // this is called every time the sphere needs to be redrawn 
 //
-void Sphere::setRenderState(GLapp *app, double now)
+void Sphere::prepare(GLapp *app, double now)
 {
-    // inherit parent's draw settings
-    Object::setRenderState(app, now);
-
     // update model position
     objectShaderData.WorldFromModel = translate(mat4(1), 100.f * vec3(cosf(now), sinf(now), 1));
     objectShaderData.ModelFromWorld = inverse(objectShaderData.WorldFromModel);
 
-    glBindBufferBase(GL_UNIFORM_BUFFER, 1, bufferIDs[OBJECT_UNIFORM_BUFFER]);
-    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(ObjectShaderData), &objectShaderData);
+    // inherit parent's settings
+    Object::prepare(app, now);
 }
-
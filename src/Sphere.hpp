@@ -9,6 +9,9 @@ public:
     // create sphere given latitude and longitude sizes and color texture
     Sphere(int width, int height, glm::vec3 size, const char *texturePPM);
 
-    // update render state, overridden to move object around
-    virtual void setRenderState(GLapp *app, double now) override;
+    // update object data, overridden to move object around
+    virtual void prepare(GLapp *app, double now) override;
+
+    // moves, so never merged into a static batch
+    virtual bool isStatic() const override { return false; }
 };
@@ -0,0 +1,155 @@
+// static objects merged into one mesh, drawn with a few multi-draws
+
+#include "StaticBatch.hpp"
+#include "GLapp.hpp"
+#include "GLState.hpp"
+#include "TextureResidency.hpp"
+
+#include <GL/glew.h>
+
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <stdio.h>
+
+using namespace glm;  // avoid glm:: for all glm types and functions
+
+// CPU copy of a mesh's buffers
+struct MeshData {
+    std::vector<vec3> vert, norm;
+    std::vector<vec2> uv;
+    std::vector<unsigned int> indices;
+};
+
+// read one GL buffer into an array
+template <typename T>
+static void readBuffer(unsigned int bufferID, size_t count, std::vector<T> &data)
+{
+    data.resize(count);
+    glBindBuffer(GL_COPY_READ_BUFFER, bufferID);
+    glGetBufferSubData(GL_COPY_READ_BUFFER, 0, count * sizeof(T), data.data());
+}
+
+void StaticBatch::release()
+{
+    if (drawBufferID) glDeleteBuffers(1, &drawBufferID);
+    drawBufferID = 0;
+    TextureResidency::shared().removeBuffer(drawBytes);
+    drawBytes = 0;
+    mesh = nullptr;
+    batches.clear();
+}
+
+void StaticBatch::bake(GLapp *app)
+{
+    baked = true;
+
+    // group by program features & texture array
+    // objects with a texture of their own need it bound, so aren't merged
+    typedef std::pair<unsigned int, int> Key;
+    std::map<Key, std::vector<Object*>> groups;
+    for (Object *object : app->objects) {
+        unsigned int features = object->shaderFeatures(app);
+        if (!object->isStatic() || object->batched || (features & Object::HAS_TEXTURE))
+            continue;
+        const Texture &color = *object->textures[Object::COLOR_TEXTURE];
+        groups[Key(features, color.array ? color.array->index : -1)].push_back(object);
+    }
+    if (groups.empty()) return;
+
+    // source meshes are read back once, however many objects share them
+    std::unordered_map<const MeshBuffer*, MeshData> sources;
+    std::vector<vec3> vert, norm;
+    std::vector<vec2> uv;
+    std::vector<ivec2> drawData;
+    std::vector<unsigned int> indices;
+    std::vector<unsigned int> remap, stamp;
+    unsigned int serial = 0;
+
+    for (auto &group : groups) {
+        Batch batch;
+        Object &first = *group.second.front();
+        batch.program = Object::programFor(group.first.first | Object::STATIC_BATCH);
+        batch.array = first.textures[Object::COLOR_TEXTURE]->array;
+        batch.objectShaderData = {
+            mat4(1), mat4(1),           // already in world space
+            0,                          // material per vertex
+            group.first.second, 0, 0    // color array, layer per vertex & padding
+        };
+        batch.uniformOffset = 0;
+
+        for (Object *object : group.second) {
+            MeshData &source = sources[object->mesh.get()];
+            if (source.indices.empty()) {
+                const MeshBuffer &m = *object->mesh;
+                readBuffer(m.bufferIDs[MeshBuffer::POSITION_BUFFER], m.numVerts, source.vert);
+                readBuffer(m.bufferIDs[MeshBuffer::NORMAL_BUFFER], m.numVerts, source.norm);
+                readBuffer(m.bufferIDs[MeshBuffer::UV_BUFFER], m.numVerts, source.uv);
+                readBuffer(m.bufferIDs[MeshBuffer::INDEX_BUFFER], m.numIndices, source.indices);
+            }
+
+            // copy the vertices this object uses, in world space
+            if (remap.size() < source.vert.size()) {
+                remap.resize(source.vert.size());
+                stamp.resize(source.vert.size(), 0);
+            }
+            ++serial;
+            const mat4 &worldFromModel = object->objectShaderData.WorldFromModel;
+            mat3 normalFromModel = transpose(mat3(object->objectShaderData.ModelFromWorld));
+            const Texture &color = *object->textures[Object::COLOR_TEXTURE];
+            ivec2 data(int(object->objectShaderData.Material), color.array ? color.layer : 0);
+            size_t firstVertex = vert.size(), firstIndex = indices.size();
+            for (unsigned int i = 0; i < object->numIndices; ++i) {
+                unsigned int v = source.indices[object->firstIndex + i] + object->baseVertex;
+                if (stamp[v] != serial) {
+                    stamp[v] = serial;
+                    remap[v] = unsigned(vert.size() - firstVertex);
+                    vert.push_back(vec3(worldFromModel * vec4(source.vert[v], 1)));
+                    norm.push_back(normalFromModel * source.norm[v]);
+                    uv.push_back(source.uv[v]);
+                    drawData.push_back(data);
+                }
+                indices.push_back(remap[v]);
+            }
+
+            batch.counts.push_back(int(object->numIndices));
+            batch.offsets.push_back((const void*)(firstIndex * sizeof(unsigned int)));
+            batch.baseVertices.push_back(int(firstVertex));
+            object->batched = true;
+            ++numObjects;
+        }
+        batches.push_back(std::move(batch));
+    }
+
+    // merged buffers, plus the per-vertex draw data in the same vertex array
+    mesh = std::make_shared<MeshBuffer>(vert.size(), vert.data(), norm.data(), uv.data(),
+        indices.size(), indices.data());
+    glGenBuffers(1, &drawBufferID);
+    GLState &gl = GLState::shared();
+    gl.bindVertexArray(mesh->varrayID);
+    gl.bindBuffer(GL_ARRAY_BUFFER, drawBufferID);
+    drawBytes = drawData.size() * sizeof(ivec2);
+    glBufferData(GL_ARRAY_BUFFER, drawBytes, drawData.data(), GL_STATIC_DRAW);
+    TextureResidency::shared().addBuffer(drawBytes);
+    glVertexAttribIPointer(MeshBuffer::DRAW_ATTRIB, 2, GL_INT, 0, 0);
+    glEnableVertexAttribArray(MeshBuffer::DRAW_ATTRIB);
+    gl.bindVertexArray(0);
+
+    printf("static batch: %u objects in %zu draws, %zu vertices (%.2f MB)\n",
+        numObjects, batches.size(), vert.size(),
+        (mesh->memory() + drawBytes) / 1048576.);
+}
+
+void StaticBatch::draw(GLapp *app)
+{
+    GLState &gl = GLState::shared();
+    for (Batch &batch : batches) {
+        gl.useProgram(batch.program->programID);
+        gl.bindVertexArray(mesh->varrayID);
+        gl.bindBufferBase(GL_UNIFORM_BUFFER, 0, app->sceneUniformsID);
+        app->queue.uniforms.bind(1, batch.uniformOffset, sizeof(Object::ObjectShaderData));
+        gl.bindBufferBase(GL_UNIFORM_BUFFER, 2, app->materialUniformsID);
+        glMultiDrawElementsBaseVertex(GL_TRIANGLES, batch.counts.data(), GL_UNSIGNED_INT,
+            batch.offsets.data(), GLsizei(batch.counts.size()), batch.baseVertices.data());
+    }
+}
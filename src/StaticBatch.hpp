@@ -0,0 +1,57 @@
+// static objects merged into one mesh, drawn with a few multi-draws
+//
+// Objects that never move and have no texture of their own are copied into
+// a single vertex & index buffer, transformed to world space. Material and
+// texture layer move from per-object uniforms to a per-vertex attribute, so
+// objects sharing a shader program & texture array draw together with one
+// glMultiDrawElementsBaseVertex. Vertices shared between objects are
+// duplicated, since their per-vertex materials may differ.
+#pragma once
+
+#include "MeshBuffer.hpp"
+#include "Object.hpp"
+#include "ShaderProgram.hpp"
+#include "TextureArray.hpp"
+#include <memory>
+#include <vector>
+
+class StaticBatch {
+public:
+    // objects drawn with one multi-draw call
+    struct Batch {
+        std::shared_ptr<ShaderProgram> program;     // STATIC_BATCH variant
+        std::shared_ptr<TextureArray> array;        // color texture array, if any
+        Object::ObjectShaderData objectShaderData;  // identity transform & color array
+        size_t uniformOffset;                       // this frame's copy in the uniform ring
+
+        // glMultiDrawElementsBaseVertex arguments, one per object
+        std::vector<int> counts;
+        std::vector<const void*> offsets;
+        std::vector<int> baseVertices;
+    };
+    std::vector<Batch> batches;
+
+    std::shared_ptr<MeshBuffer> mesh;   // merged geometry
+    unsigned int drawBufferID;          // per-vertex material & layer
+    size_t drawBytes;                   // size of drawBufferID
+    unsigned int numObjects;            // objects merged
+    bool baked;                         // bake() has run
+
+public:
+    StaticBatch() : drawBufferID(0), drawBytes(0), numObjects(0), baked(false) {}
+
+    // free GL objects, before the GL context goes away
+    ~StaticBatch() { release(); }
+    void release();
+
+    // batch owns GL objects, so no copies
+    StaticBatch(const StaticBatch &) = delete;
+    StaticBatch &operator=(const StaticBatch &) = delete;
+
+    // merge static objects of app, marking them batched
+    // call once textures are loaded & packed, so features won't change
+    void bake(class GLapp *app);
+
+    // draw all batches, after their uniform blocks are in the ring
+    void draw(class GLapp *app);
+};
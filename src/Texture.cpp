@@ -0,0 +1,241 @@
+// GL texture loaded from a PPM image
+
+#include "Texture.hpp"
+#include "BC1Encoder.hpp"
+#include "CompressedTexture.hpp"
+#include "MappedFile.hpp"
+
+#include <GL/glew.h>
+
+#include <algorithm>
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+using namespace glm;  // avoid glm:: for all glm types and functions
+
+int Texture::Source::levels() const
+{
+    if (compressed) return int(compressed->header().numLevels);
+    int levels = 1;
+    while ((width >> levels) > 0 || (height >> levels) > 0) ++levels;
+    return levels;
+}
+
+int Texture::Source::lowLevel() const
+{
+    int level = 0, last = levels() - 1;
+    while (level < last && std::max(width >> level, height >> level) > TextureResidency::LOW_SIZE)
+        ++level;
+    return level;
+}
+
+size_t Texture::Source::bytes(int first) const
+{
+    size_t total = 0;
+    for (int i = first; i < levels(); ++i) {
+        if (compressed) total += compressed->header().levelSize[i];
+        else total += size_t(std::max(width >> i, 1)) * std::max(height >> i, 1) * sizeof(u8vec3);
+    }
+    return total;
+}
+
+void Texture::Source::lowImage(std::vector<u8vec3> &low) const
+{
+    // walk the mapped file bottom up, halving into ping-pong buffers
+    const u8vec3 *level = pixels + size_t(height - 1) * width;
+    ptrdiff_t stride = -ptrdiff_t(width);
+    std::vector<u8vec3> mip[2];
+    int first = lowLevel();
+    for (int i = 0; i < first; ++i) {
+        int levelWidth = std::max(width >> i, 1), levelHeight = std::max(height >> i, 1);
+        std::vector<u8vec3> &next = mip[i & 1];
+        next.resize(size_t(std::max(levelWidth / 2, 1)) * std::max(levelHeight / 2, 1));
+        downsample(level, stride, levelWidth, levelHeight, next.data());
+        level = next.data();
+        stride = std::max(levelWidth / 2, 1);
+    }
+    low.insert(low.end(), level, level + size_t(std::max(width >> first, 1)) * std::max(height >> first, 1));
+}
+
+Texture::Texture() :
+    width(1), height(1), layer(-1)
+{
+    // can detect 1x1 texture size in shader for missing texture
+    glGenTextures(1, &textureID);
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+    bytes = residentBytes = 3;
+}
+
+Texture::~Texture()
+{
+    glDeleteTextures(1, &textureID);
+}
+
+void Texture::upload(const Source &image)
+{
+    source = image;
+    width = source.width;
+    height = source.height;
+    bytes = source.bytes(0);
+    specify(0, nullptr);
+    evicted = false;
+}
+
+bool Texture::canEvict() const
+{
+    return textureID && !array && source.isValid() && source.lowLevel() > 0;
+}
+
+void Texture::evict()
+{
+    int first = source.lowLevel();
+    std::vector<u8vec3> low;
+    // filtered from the mapped source, since reading back GL's level would wait on the GPU
+    if (!source.compressed)
+        source.lowImage(low);
+    specify(first, low.data());
+    evicted = true;
+}
+
+void Texture::restore()
+{
+    specify(0, nullptr);
+    evicted = false;
+}
+
+void Texture::specify(int first, const u8vec3 *lowImage)
+{
+    // new texture object, so the driver frees all the old levels
+    glDeleteTextures(1, &textureID);
+    glGenTextures(1, &textureID);
+    glBindTexture(GL_TEXTURE_2D, textureID);
+
+    unsigned int unpackID = 0;
+    std::vector<char> fallback;
+    if (source.compressed) {
+        const CompressedTexture::Header &head = source.compressed->header();
+        int levels = int(head.numLevels);
+
+        // levels are contiguous, so one unpack buffer holds them all
+        const char *pixels = stagePixels(source.compressed->level(first), source.bytes(first), 1, false,
+            unpackID, fallback);
+        for (int i = first; i < levels; ++i) {
+            size_t offset = head.levelOffset[i] - head.levelOffset[first];
+            glCompressedTexImage2D(GL_TEXTURE_2D, i - first, GL_COMPRESSED_RGB_S3TC_DXT1_EXT,
+                std::max(width >> i, 1), std::max(height >> i, 1), 0,
+                GLsizei(head.levelSize[i]), (void*)(uintptr_t(pixels) + offset));
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1 - first);
+    }
+    else {
+        int w = std::max(width >> first, 1), h = std::max(height >> first, 1);
+        const char *pixels = first == 0
+            ? stagePixels(source.pixels, size_t(w) * sizeof(u8vec3), h, true, unpackID, fallback)
+            : stagePixels(lowImage, size_t(w) * sizeof(u8vec3), h, false, unpackID, fallback);
+
+        // rows are tightly packed, not 4-byte aligned
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, w, h, 0, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glGenerateMipmap(GL_TEXTURE_2D);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    // buffer is freed once the driver is done with it
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glDeleteBuffers(1, &unpackID);
+
+    residentBytes = source.bytes(first);
+}
+
+const char *Texture::stagePixels(const void *data, size_t rowBytes, int rows, bool flipY,
+    unsigned int &unpackID, std::vector<char> &fallback)
+{
+    size_t bytes = rowBytes * rows;
+    const char *src = (const char*)data;
+    glGenBuffers(1, &unpackID);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, unpackID);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+    char *dest = (char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (dest) {
+        for (int y = 0; y < rows; ++y)
+            memcpy(dest + (flipY ? rows - 1 - y : y) * rowBytes, src + y * rowBytes, rowBytes);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        return nullptr;
+    }
+
+    // upload straight from client memory instead
+    fprintf(stderr, "can't map pixel unpack buffer, uploading without it\n");
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glDeleteBuffers(1, &unpackID);
+    unpackID = 0;
+    if (!flipY) return src;
+    fallback.resize(bytes);
+    for (int y = 0; y < rows; ++y)
+        memcpy(&fallback[(rows - 1 - y) * rowBytes], src + y * rowBytes, rowBytes);
+    return fallback.data();
+}
+
+// skip whitespace and # comments in a PPM header
+static const char *skipPPMSpace(const char *p, const char *end)
+{
+    while (p < end) {
+        if (*p == '#')
+            while (p < end && *p != '\n') ++p;
+        else if (isspace((unsigned char)*p))
+            ++p;
+        else
+            break;
+    }
+    return p;
+}
+
+// read a positive decimal number from a PPM header, 0 if there isn't one
+static const char *parsePPMInt(const char *p, const char *end, int &value)
+{
+    p = skipPPMSpace(p, end);
+    value = 0;
+    while (p < end && *p >= '0' && *p <= '9' && value < 1 << 20)
+        value = 10 * value + (*p++ - '0');
+    return p;
+}
+
+const u8vec3 *Texture::parsePPM(const MappedFile &file, const char *imagefile, int &width, int &height)
+{
+    if (!file.isOpen()) {
+        fprintf(stderr, "can't open %s\n", imagefile);
+        return nullptr;
+    }
+
+    // check that "magic number" at beginning of file is P6
+    const char *p = file.data, *end = file.end();
+    if (file.size < 2 || p[0] != 'P' || p[1] != '6') {
+        fprintf(stderr, "unknown image format %s\n", imagefile);
+        return nullptr;
+    }
+
+    // read image size, maximum value, and single whitespace before data
+    int maxval = 0;
+    p = parsePPMInt(p + 2, end, width);
+    p = parsePPMInt(p, end, height);
+    p = parsePPMInt(p, end, maxval);
+    if (width <= 0 || height <= 0 || maxval != 255 || p == end || !isspace((unsigned char)*p)) {
+        fprintf(stderr, "bad PPM header in %s\n", imagefile);
+        return nullptr;
+    }
+    ++p;
+
+    // check remaining file size matches image size
+    // if this fails, you may have checked a ppm file out
+    // as text rather than binary
+    if (size_t(end - p) != size_t(width) * height * sizeof(u8vec3)) {
+        fprintf(stderr, "PPM data size mismatch in %s\n", imagefile);
+        return nullptr;
+    }
+    return (const u8vec3*)p;
+}
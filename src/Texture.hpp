@@ -0,0 +1,85 @@
+// GL texture loaded from a PPM image
+#pragma once
+
+#include "TextureResidency.hpp"
+#include <glm/glm.hpp>
+#include <memory>
+#include <stddef.h>
+#include <vector>
+
+class Texture : public ResidentTexture {
+public:
+    // image a texture is built from, kept so it can be rebuilt after eviction
+    // either compressed, or raw pixels in a mapped file
+    struct Source {
+        std::shared_ptr<class CompressedTexture> compressed;
+        std::shared_ptr<class MappedFile> file;     // keeps pixels mapped
+        const glm::u8vec3 *pixels = nullptr;        // top row first, nullptr if not used
+        int width = 0, height = 0;
+
+        // has an image to upload
+        bool isValid() const { return compressed || pixels; }
+
+        // mip levels, down to 1x1
+        int levels() const;
+
+        // first mip level no larger than TextureResidency::LOW_SIZE
+        int lowLevel() const;
+
+        // GPU memory for mip levels from first on
+        size_t bytes(int first) const;
+
+        // append the RGB image box-filtered down to lowLevel(), bottom row first
+        void lowImage(std::vector<glm::u8vec3> &low) const;
+    };
+    Source source;
+
+    unsigned int textureID;     // GL texture object
+    int width, height;          // image size, 1x1 for no image
+
+    // layer holding this image once packed into an array, -1 if not packed
+    // a packed texture no longer has its own textureID
+    std::shared_ptr<class TextureArray> array;
+    int layer;
+
+public:
+    // create a 1x1 texture, which shaders detect as missing
+    // stands in until upload() gives it an image
+    Texture();
+
+    // free GL texture
+    ~Texture();
+
+    // texture owns its GL object, so no copies
+    Texture(const Texture &) = delete;
+    Texture &operator=(const Texture &) = delete;
+
+    // replace texture contents with image and all its mip levels
+    // RGB images have mipmaps built, compressed images include them
+    // must be called on the GL thread
+    void upload(const Source &image);
+
+    // ResidentTexture
+    bool canEvict() const override;
+    void evict() override;
+    void restore() override;
+
+    // fill a new pixel unpack buffer and leave it bound for the next upload
+    // streaming lets the driver copy to the GPU asynchronously
+    // flipY reverses the rows of a top-first image to GL's bottom-first order
+    // sets unpackID to the buffer, to delete once the upload has been issued
+    // returns the pixels to upload from: offset 0 of the buffer, or if it can't be
+    // mapped, client memory with no buffer bound, flipped into fallback if needed
+    static const char *stagePixels(const void *data, size_t rowBytes, int rows, bool flipY,
+        unsigned int &unpackID, std::vector<char> &fallback);
+
+    // find the pixels of a memory-mapped PPM file
+    // safe to call from any thread, returns nullptr with a message on failure
+    static const glm::u8vec3 *parsePPM(const class MappedFile &file, const char *imagefile,
+        int &width, int &height);
+
+private:
+    // recreate the GL texture from source levels first and up
+    // RGB textures past level 0 start from lowImage, already bottom row first
+    void specify(int first, const glm::u8vec3 *lowImage);
+};
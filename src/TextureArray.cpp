@@ -0,0 +1,130 @@
+// GL texture array holding same-size images as layers
+
+#include "TextureArray.hpp"
+#include "CompressedTexture.hpp"
+
+#include <GL/glew.h>
+
+#include <algorithm>
+
+using namespace glm;  // avoid glm:: for all glm types and functions
+
+TextureArray::TextureArray(const std::vector<Texture::Source> &sources, int index) :
+    sources(sources), textureID(0),
+    width(sources[0].width), height(sources[0].height),
+    layers(int(sources.size())), levels(sources[0].levels()),
+    compressed(sources[0].compressed != nullptr), index(index)
+{
+    bytes = sources[0].bytes(0) * layers;
+    specify(0, nullptr);
+}
+
+TextureArray::~TextureArray()
+{
+    glDeleteTextures(1, &textureID);
+}
+
+bool TextureArray::canEvict() const
+{
+    return sources[0].lowLevel() > 0;
+}
+
+void TextureArray::evict()
+{
+    int first = sources[0].lowLevel();
+    std::vector<u8vec3> low;
+    // filtered from the mapped sources, since reading back GL's level would wait on the GPU
+    if (!compressed)
+        for (const Texture::Source &source : sources)
+            source.lowImage(low);
+    specify(first, low.data());
+    evicted = true;
+}
+
+void TextureArray::restore()
+{
+    specify(0, nullptr);
+    evicted = false;
+}
+
+void TextureArray::specify(int first, const u8vec3 *lowImage)
+{
+    // new texture object, so the driver frees all the old levels
+    // bound on its own unit, so a restore in the middle of a frame is ready to draw
+    glDeleteTextures(1, &textureID);
+    glGenTextures(1, &textureID);
+    bind();
+
+    int w = std::max(width >> first, 1), h = std::max(height >> first, 1);
+    if (compressed) {
+        // allocate every level, filled in layer by layer
+        for (int i = first; i < levels; ++i) {
+            int lw = std::max(width >> i, 1), lh = std::max(height >> i, 1);
+            size_t levelBytes = size_t((lw + 3) / 4) * ((lh + 3) / 4) * 8 * layers;
+            glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, i - first, GL_COMPRESSED_RGB_S3TC_DXT1_EXT,
+                lw, lh, layers, 0, GLsizei(levelBytes), nullptr);
+        }
+        for (int layer = 0; layer < layers; ++layer)
+            uploadLayer(layer, first);
+    }
+    else if (first > 0) {
+        // rows are tightly packed, not 4-byte aligned
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGB, w, h, layers, 0,
+            GL_RGB, GL_UNSIGNED_BYTE, lowImage);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    }
+    else {
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGB, w, h, layers, 0,
+            GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+        for (int layer = 0; layer < layers; ++layer)
+            uploadLayer(layer, 0);
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    }
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levels - 1 - first);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glActiveTexture(GL_TEXTURE0);
+
+    residentBytes = sources[0].bytes(first) * layers;
+}
+
+void TextureArray::uploadLayer(int layer, int first)
+{
+    const Texture::Source &source = sources[layer];
+    unsigned int unpackID;
+    std::vector<char> fallback;
+    if (source.compressed) {
+        // levels are contiguous, so one unpack buffer holds them all
+        const CompressedTexture::Header &head = source.compressed->header();
+        const char *pixels = Texture::stagePixels(source.compressed->level(first), source.bytes(first), 1, false,
+            unpackID, fallback);
+        for (int i = first; i < levels; ++i) {
+            size_t offset = head.levelOffset[i] - head.levelOffset[first];
+            glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, i - first, 0, 0, layer,
+                std::max(width >> i, 1), std::max(height >> i, 1), 1,
+                GL_COMPRESSED_RGB_S3TC_DXT1_EXT, GLsizei(head.levelSize[i]),
+                (void*)(uintptr_t(pixels) + offset));
+        }
+    }
+    else {
+        const char *pixels = Texture::stagePixels(source.pixels, size_t(width) * sizeof(u8vec3), height, true,
+            unpackID, fallback);
+
+        // rows are tightly packed, not 4-byte aligned
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, width, height, 1,
+            GL_RGB, GL_UNSIGNED_BYTE, pixels);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glDeleteBuffers(1, &unpackID);
+}
+
+void TextureArray::bind() const
+{
+    glActiveTexture(GL_TEXTURE0 + FIRST_UNIT + index);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, textureID);
+}
@@ -0,0 +1,49 @@
+// GL texture array holding same-size images as layers
+#pragma once
+
+#include "Texture.hpp"
+#include "TextureResidency.hpp"
+#include <glm/glm.hpp>
+#include <stddef.h>
+#include <vector>
+
+class TextureArray : public ResidentTexture {
+public:
+    // arrays are bound to units FIRST_UNIT and up, one per TextureArrays
+    // entry in the shaders, which has MAX_ARRAYS entries
+    enum { FIRST_UNIT = 1, MAX_ARRAYS = 8 };
+
+    std::vector<Texture::Source> sources;   // image for each layer
+    unsigned int textureID;     // GL_TEXTURE_2D_ARRAY texture object
+    int width, height;          // size of every layer
+    int layers, levels;         // layer count & mip levels per layer
+    bool compressed;            // BC1 layers, otherwise RGB
+    int index;                  // position in the TextureArrays shader array
+
+public:
+    // build an array from images that all have the same size, levels & format
+    TextureArray(const std::vector<Texture::Source> &sources, int index);
+
+    // free GL texture
+    ~TextureArray();
+
+    // array owns its GL object, so no copies
+    TextureArray(const TextureArray &) = delete;
+    TextureArray &operator=(const TextureArray &) = delete;
+
+    // ResidentTexture
+    bool canEvict() const override;
+    void evict() override;
+    void restore() override;
+
+    // bind to texture unit FIRST_UNIT + index
+    void bind() const;
+
+private:
+    // recreate the GL texture from source levels first and up
+    // RGB arrays past level 0 start from lowImage, all layers bottom row first
+    void specify(int first, const glm::u8vec3 *lowImage);
+
+    // fill one layer from its source, levels first and up
+    void uploadLayer(int layer, int first);
+};
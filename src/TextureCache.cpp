@@ -0,0 +1,199 @@
+// process-wide cache sharing one GL texture per image file
+
+#include "TextureCache.hpp"
+#include "CompressedTexture.hpp"
+#include "MappedFile.hpp"
+#include "TextureArray.hpp"
+#include "TextureResidency.hpp"
+#include "ThreadPool.hpp"
+#include "config.h"
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <map>
+#include <tuple>
+#include <stdio.h>
+
+std::shared_ptr<Texture> TextureCache::get(const char *imagefile)
+{
+    // same path resolution as Object always used, then canonical form for the key
+    std::string key;
+    if (imagefile && imagefile[0]) {
+        std::filesystem::path path(imagefile);
+        if (path.is_relative()) path = std::filesystem::path(PROJECT_DATA_DIR) / path;
+        std::error_code error;
+        std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+        key = (error ? path : canonical).u8string();
+    }
+
+    Entry &entry = textures[key];
+    std::shared_ptr<Texture> texture = entry.texture.lock();
+    if (texture) {
+        // bytes aren't known until the image arrives, count those hits later
+        // the missing-texture placeholder and failed images save nothing
+        ++hits;
+        if (texture->source.isValid()) bytesSaved += texture->bytes;
+        else if (!key.empty()) ++entry.waitingHits;
+        return texture;
+    }
+
+    texture = std::make_shared<Texture>();
+    entry = {texture, 0};
+    if (key.empty()) return texture;
+
+    // compressed textures need S3TC, which all desktop drivers have
+#ifdef GLAPP_COMPRESS_TEXTURES
+    bool compress = GLEW_EXT_texture_compression_s3tc;
+#else
+    bool compress = false;
+#endif
+
+    // decode on a worker, keeping the placeholder until upload
+    if (pending++ == 0) loadStart = glfwGetTime();
+    std::weak_ptr<Texture> weak = texture;
+    ThreadPool::shared().enqueue([this, key, weak, compress] {
+        Decoded result = {key, weak, {}};
+        Texture::Source &source = result.source;
+        const char *data = nullptr;
+        size_t size = 0;
+        if (compress) {
+            source.compressed = std::make_shared<CompressedTexture>(key.c_str());
+            if (!source.compressed->isValid())
+                source.compressed = nullptr;
+            else {
+                source.width = int(source.compressed->header().width);
+                source.height = int(source.compressed->header().height);
+                if (source.compressed->isMapped()) {
+                    data = (const char*)source.compressed->level(0);
+                    size = source.compressed->levelBytes();
+                }
+            }
+        }
+        else {
+            source.file = std::make_shared<MappedFile>(key.c_str());
+            source.pixels = Texture::parsePPM(*source.file, key.c_str(), source.width, source.height);
+            if (source.pixels) {
+                data = source.file->data;
+                size = source.file->size;
+            }
+        }
+
+        // fault pages in here, so the upload copy doesn't wait on the disk
+        volatile char touch = 0;
+        for (size_t i = 0; i < size; i += 4096)
+            touch += data[i];
+
+        std::lock_guard<std::mutex> guard(lock);
+        decoded.push_back(std::move(result));
+    });
+    return texture;
+}
+
+void TextureCache::update()
+{
+    if (pending == 0) return;
+
+    std::vector<Decoded> ready;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        ready.swap(decoded);
+    }
+
+    for (Decoded &result : ready) {
+        --pending;
+        std::shared_ptr<Texture> texture = result.texture.lock();
+        if (!texture || !result.source.isValid()) continue;  // unused or failed
+
+        texture->upload(result.source);
+        ++loads;
+
+        // only hits on this texture waited for it, not on a newer entry for the same file
+        auto entry = textures.find(result.key);
+        if (entry != textures.end() && entry->second.texture.lock() == texture) {
+            bytesSaved += entry->second.waitingHits * texture->bytes;
+            entry->second.waitingHits = 0;
+        }
+    }
+
+    if (!ready.empty() && pending == 0) {
+        printf("%u textures loaded in %.2f ms, %u shared (%.2f MB of GPU memory saved)\n",
+            loads, 1000 * (glfwGetTime() - loadStart), hits, bytesSaved / 1048576.);
+        pack();
+    }
+}
+
+void TextureCache::pack()
+{
+    // group by layer format: size, mip levels & compression
+    typedef std::tuple<int, int, int, bool> Format;
+    std::map<Format, std::vector<std::shared_ptr<Texture>>> groups;
+    for (auto &entry : textures) {
+        std::shared_ptr<Texture> texture = entry.second.texture.lock();
+        if (!texture || texture->array || !texture->source.isValid()) continue;
+
+        const Texture::Source &source = texture->source;
+        groups[Format(source.width, source.height, source.levels(), source.compressed != nullptr)]
+            .push_back(texture);
+    }
+
+    // largest groups first, while there are array units left
+    std::vector<std::pair<Format, std::vector<std::shared_ptr<Texture>>>> order(groups.begin(), groups.end());
+    std::stable_sort(order.begin(), order.end(), [](const auto &a, const auto &b) {
+        return a.second.size() > b.second.size();
+    });
+
+    unsigned int packed = 0;
+    for (auto &group : order) {
+        if (arrays.size() == TextureArray::MAX_ARRAYS) break;
+
+        std::vector<std::shared_ptr<Texture>> &members = group.second;
+        std::vector<Texture::Source> sources;
+        for (auto &texture : members)
+            sources.push_back(texture->source);
+        auto array = std::make_shared<TextureArray>(sources, int(arrays.size()));
+
+        // textures now live in the array
+        for (int layer = 0; layer < int(members.size()); ++layer) {
+            Texture &texture = *members[layer];
+            glDeleteTextures(1, &texture.textureID);
+            texture.textureID = 0;
+            texture.residentBytes = 0;
+            texture.evicted = false;
+            texture.array = array;
+            texture.layer = layer;
+            ++packed;
+        }
+        arrays.push_back(array);
+    }
+
+    if (packed)
+        printf("packed %u textures into %zu texture arrays\n", packed, arrays.size());
+}
+
+void TextureCache::bindArrays() const
+{
+    for (auto &array : arrays)
+        array->bind();
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void TextureCache::release()
+{
+    arrays.clear();
+}
+
+TextureCache::TextureCache() :
+    pending(0), loadStart(0), loads(0), hits(0), bytesSaved(0)
+{
+    // statics are destroyed in reverse order, so the registry outlives our textures
+    TextureResidency::shared();
+}
+
+TextureCache &TextureCache::shared()
+{
+    static TextureCache cache;
+    return cache;
+}
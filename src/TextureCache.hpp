@@ -0,0 +1,75 @@
+// process-wide cache sharing one GL texture per image file
+//
+// Images are decoded, or BC1 compressed and cached, on the shared thread
+// pool. Each texture is a 1x1 placeholder until update() uploads its image
+// on the GL thread. Whenever all pending images are in, textures of the same
+// size are packed into texture arrays, bound once for the whole scene.
+// Textures loaded later are packed into new arrays the next time.
+#pragma once
+
+#include "Texture.hpp"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class TextureCache {
+private:
+    // image loaded by a worker, waiting for upload
+    struct Decoded {
+        std::string key;
+        std::weak_ptr<Texture> texture;
+        Texture::Source source;
+    };
+
+    // keyed by canonical path, so different spellings of a file match
+    // entries expire when the last object using the texture goes away
+    struct Entry {
+        std::weak_ptr<Texture> texture;
+        unsigned int waitingHits;       // hits before the image arrived
+    };
+    std::unordered_map<std::string, Entry> textures;
+
+    std::mutex lock;                        // guards decoded
+    std::vector<Decoded> decoded;
+    unsigned int pending;                   // decodes not yet uploaded
+    double loadStart;                       // time first pending decode started
+
+    // arrays of packed textures, bound together for the whole scene
+    std::vector<std::shared_ptr<class TextureArray>> arrays;
+
+public:
+    // statistics since startup
+    unsigned int loads;         // images decoded and uploaded
+    unsigned int hits;          // requests served by an existing texture
+    size_t bytesSaved;          // GPU memory not spent on duplicate textures
+
+public:
+    TextureCache();
+
+    // texture for image file, starting a background load if it's new
+    // nullptr or "" gives the shared 1x1 missing-texture placeholder
+    std::shared_ptr<Texture> get(const char *imagefile);
+
+    // upload images that finished decoding, call once per frame on the GL thread
+    // packs new textures into arrays each time the last pending image is in
+    void update();
+
+    // images still decoding, so textures may still change or be packed
+    bool isLoading() const { return pending > 0; }
+
+    // bind all texture arrays to their units, once per frame
+    void bindArrays() const;
+
+    // free texture arrays once objects are gone, before the GL context goes away
+    void release();
+
+    // cache used by all objects, must be used from the GL thread
+    static TextureCache &shared();
+
+private:
+    // move loaded, unpacked textures into new arrays, grouped by size & format
+    // earlier arrays are left alone, so a format can end up in several
+    void pack();
+};
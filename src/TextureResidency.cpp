@@ -0,0 +1,85 @@
+// GPU memory budget for textures and buffers, evicting least recently drawn textures
+
+#include "TextureResidency.hpp"
+#include "config.h"
+
+#include <algorithm>
+#include <stdio.h>
+
+ResidentTexture::ResidentTexture() :
+    bytes(0), residentBytes(0), lastUsed(0), evicted(false)
+{
+    TextureResidency::shared().add(this);
+}
+
+ResidentTexture::~ResidentTexture()
+{
+    TextureResidency::shared().remove(this);
+}
+
+TextureResidency::TextureResidency() :
+    budget(size_t(GLAPP_TEXTURE_BUDGET_MB) << 20), frame(0),
+    residentBytes(0), bufferBytes(0), evictions(0), reloads(0)
+{
+}
+
+void TextureResidency::add(ResidentTexture *texture)
+{
+    textures.push_back(texture);
+}
+
+void TextureResidency::remove(ResidentTexture *texture)
+{
+    auto found = std::find(textures.begin(), textures.end(), texture);
+    if (found != textures.end()) {
+        *found = textures.back();
+        textures.pop_back();
+    }
+}
+
+void TextureResidency::use(ResidentTexture &texture)
+{
+    texture.lastUsed = frame;
+    if (!texture.evicted) return;
+
+    size_t before = texture.residentBytes;
+    texture.restore();
+    residentBytes += texture.residentBytes - before;
+    ++reloads;
+}
+
+void TextureResidency::update()
+{
+    if (evictions || reloads)
+        printf("frame %u: %.2f MB of textures & %.2f MB of buffers resident, %u evicted, %u reloaded\n",
+            frame, residentBytes / 1048576., bufferBytes / 1048576., evictions, reloads);
+    evictions = reloads = 0;
+    ++frame;
+
+    residentBytes = 0;
+    for (ResidentTexture *texture : textures)
+        residentBytes += texture->residentBytes;
+    if (residentBytes + bufferBytes <= budget) return;
+
+    // least recently drawn first, skipping anything drawn just now
+    std::vector<ResidentTexture*> candidates;
+    for (ResidentTexture *texture : textures)
+        if (!texture->evicted && texture->canEvict() && texture->lastUsed + KEEP_FRAMES < frame)
+            candidates.push_back(texture);
+    std::sort(candidates.begin(), candidates.end(),
+        [](const ResidentTexture *a, const ResidentTexture *b) { return a->lastUsed < b->lastUsed; });
+
+    for (ResidentTexture *texture : candidates) {
+        if (residentBytes + bufferBytes <= budget) break;
+        size_t before = texture->residentBytes;
+        texture->evict();
+        residentBytes -= before - texture->residentBytes;
+        ++evictions;
+    }
+}
+
+TextureResidency &TextureResidency::shared()
+{
+    static TextureResidency residency;
+    return residency;
+}
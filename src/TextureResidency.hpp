@@ -0,0 +1,76 @@
+// GPU memory budget for textures and buffers, evicting least recently drawn textures
+//
+// Every texture registers itself, and vertex, index & uniform buffers
+// report their size. When resident memory is over budget at the start of
+// a frame, textures not drawn in the last few frames drop to a small mip
+// level, least recently drawn first. Buffers count against the budget but
+// are never evicted. Drawing an evicted texture restores full resolution
+// from its source.
+#pragma once
+
+#include <stddef.h>
+#include <vector>
+
+// GPU texture that can drop to a low-resolution copy to save memory
+class ResidentTexture {
+public:
+    size_t bytes;               // GPU memory at full resolution, including mipmaps
+    size_t residentBytes;       // GPU memory used now
+    unsigned int lastUsed;      // frame it was last drawn in
+    bool evicted;               // holding only low-resolution mip levels
+
+public:
+    // register with TextureResidency::shared()
+    ResidentTexture();
+    virtual ~ResidentTexture();
+
+    // true if evict() would free memory
+    virtual bool canEvict() const = 0;
+
+    // keep only mip levels no larger than TextureResidency::LOW_SIZE
+    virtual void evict() = 0;
+
+    // reload full resolution
+    virtual void restore() = 0;
+};
+
+class TextureResidency {
+public:
+    // evicted textures keep levels up to LOW_SIZE on a side
+    // textures drawn in the last KEEP_FRAMES frames are never evicted
+    enum { LOW_SIZE = 64, KEEP_FRAMES = 2 };
+
+    size_t budget;              // bytes of texture & buffer memory before evicting
+
+private:
+    std::vector<ResidentTexture*> textures;     // all registered textures
+    unsigned int frame;                         // current frame number
+
+public:
+    // statistics for the current frame
+    size_t residentBytes;       // texture memory in use
+    size_t bufferBytes;         // buffer memory in use
+    unsigned int evictions;     // textures dropped to low resolution
+    unsigned int reloads;       // textures restored to full resolution
+
+public:
+    TextureResidency();
+
+    // called by ResidentTexture
+    void add(ResidentTexture *texture);
+    void remove(ResidentTexture *texture);
+
+    // called as GPU buffers are allocated & freed
+    void addBuffer(size_t bytes) { bufferBytes += bytes; }
+    void removeBuffer(size_t bytes) { bufferBytes -= bytes; }
+
+    // mark texture as drawn this frame, restoring it if it was evicted
+    void use(ResidentTexture &texture);
+
+    // start a new frame, evicting until under budget
+    // prints the previous frame's stats if anything was evicted or reloaded
+    void update();
+
+    // residency for all textures & buffers, must be used from the GL thread
+    static TextureResidency &shared();
+};
@@ -0,0 +1,67 @@
+// fixed set of worker threads running queued tasks
+
+#include "ThreadPool.hpp"
+
+#include <assert.h>
+
+ThreadPool::ThreadPool(unsigned int threads) :
+    stopping(false)
+{
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    if (threads == 0) threads = 1;      // concurrency unknown
+
+    for (unsigned int i = 0; i < threads; ++i)
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    shutdown();
+}
+
+void ThreadPool::shutdown()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto &worker : workers)
+        worker.join();
+    workers.clear();
+}
+
+std::future<void> ThreadPool::enqueue(std::function<void()> task)
+{
+    std::packaged_task<void()> packaged(std::move(task));
+    std::future<void> done = packaged.get_future();
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        assert(!stopping);
+        tasks.push(std::move(packaged));
+    }
+    wake.notify_one();
+    return done;
+}
+
+ThreadPool &ThreadPool::shared()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+// each worker runs tasks until asked to stop and the queue is empty
+void ThreadPool::workerLoop()
+{
+    for (;;) {
+        std::packaged_task<void()> task;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            wake.wait(guard, [this] { return stopping || !tasks.empty(); });
+            if (tasks.empty()) return;
+            task = std::move(tasks.front());
+            tasks.pop();
+        }
+        task();
+    }
+}
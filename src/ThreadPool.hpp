@@ -0,0 +1,44 @@
+// fixed set of worker threads running queued tasks
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+private:
+    std::vector<std::thread> workers;
+    std::queue<std::packaged_task<void()>> tasks;   // waiting to run
+    std::mutex lock;                                // guards tasks & stopping
+    std::condition_variable wake;                   // signals new task or stop
+    bool stopping;
+
+public:
+    // start threads, 0 = one per hardware thread
+    ThreadPool(unsigned int threads = 0);
+
+    // shutdown(), if it hasn't been already
+    ~ThreadPool();
+
+    // finish queued tasks, then join all threads
+    // call before exit, so tasks don't run against other statics being destroyed
+    // no tasks may be queued after this
+    void shutdown();
+
+    // number of worker threads
+    unsigned int size() const { return unsigned(workers.size()); }
+
+    // queue task to run on some worker thread
+    // returned future is ready when the task has finished
+    std::future<void> enqueue(std::function<void()> task);
+
+    // process-wide pool, started on first use
+    static ThreadPool &shared();
+
+private:
+    void workerLoop();
+};
@@ -0,0 +1,231 @@
+// eight triangles precomputed for ray intersection, stored by component
+
+#include "TrianglePacket.hpp"
+
+#include <math.h>
+
+// widest instruction set the compiler was told it can use
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define PACKET_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PACKET_SSE
+#endif
+
+using namespace glm;  // avoid glm:: for all glm types and functions
+
+TrianglePacket::TrianglePacket()
+{
+    float *fields[] = {Nx, Ny, Nz, V0_dot_N, Nax, Nay, Naz, Ca, Nbx, Nby, Nbz, Cb};
+    for (float *field : fields)
+        for (int lane = 0; lane < WIDTH; ++lane)
+            field[lane] = NAN;
+}
+
+TrianglePacket::Face TrianglePacket::face(vec3 v0, vec3 v1, vec3 v2)
+{
+    vec3 e0 = v1 - v2, e1 = v2 - v0, e2 = v0 - v1;
+    Face f;
+    f.N = normalize(cross(e0, e1));
+    f.V0_dot_N = dot(v0, f.N);
+    f.Na = cross(f.N, e0);  f.Na = f.Na / dot(f.Na, e2);
+    f.Nb = cross(f.N, e1);  f.Nb = f.Nb / dot(f.Nb, e0);
+    f.Ca = dot(f.Na, v1);
+    f.Cb = dot(f.Nb, v2);
+    return f;
+}
+
+void TrianglePacket::set(int lane, const Face &f)
+{
+    Nx[lane] = f.N.x;   Ny[lane] = f.N.y;   Nz[lane] = f.N.z;   V0_dot_N[lane] = f.V0_dot_N;
+    Nax[lane] = f.Na.x; Nay[lane] = f.Na.y; Naz[lane] = f.Na.z; Ca[lane] = f.Ca;
+    Nbx[lane] = f.Nb.x; Nby[lane] = f.Nb.y; Nbz[lane] = f.Nb.z; Cb[lane] = f.Cb;
+}
+
+TrianglePacket::Face TrianglePacket::get(int lane) const
+{
+    return {
+        vec3(Nx[lane], Ny[lane], Nz[lane]), V0_dot_N[lane],
+        vec3(Nax[lane], Nay[lane], Naz[lane]), Ca[lane],
+        vec3(Nbx[lane], Nby[lane], Nbz[lane]), Cb[lane]
+    };
+}
+
+void TrianglePacket::build(const vec3 *vert, const unsigned int *indices, size_t numIndices,
+    std::vector<TrianglePacket> &packets)
+{
+    size_t numTriangles = numIndices / 3;
+    size_t first = packets.size();
+    packets.resize(first + (numTriangles + WIDTH - 1) / WIDTH);
+    for (size_t i = 0; i < numTriangles; ++i)
+        packets[first + i / WIDTH].set(int(i % WIDTH),
+            face(vert[indices[3 * i]], vert[indices[3 * i + 1]], vert[indices[3 * i + 2]]));
+}
+
+// Every version computes each lane with the same operations in the same
+// order, so they agree exactly unless the compiler fuses multiply-adds
+// differently in one of them. Comparisons are written so NaN misses.
+
+// one lane's hit distance if it is hit with t in [tmin, t], otherwise NaN
+static inline float laneHit(const TrianglePacket &p, int lane, vec3 rayStart, vec3 rayDir, float tmin, float t)
+{
+    float num = p.V0_dot_N[lane] - (p.Nx[lane] * rayStart.x + p.Ny[lane] * rayStart.y + p.Nz[lane] * rayStart.z);
+    float den = p.Nx[lane] * rayDir.x + p.Ny[lane] * rayDir.y + p.Nz[lane] * rayDir.z;
+    float tHit = num / den;
+    if (!(tHit >= tmin && tHit <= t)) return NAN;
+
+    float Px = rayStart.x + rayDir.x * tHit;
+    float Py = rayStart.y + rayDir.y * tHit;
+    float Pz = rayStart.z + rayDir.z * tHit;
+    float a = (p.Nax[lane] * Px + p.Nay[lane] * Py + p.Naz[lane] * Pz) - p.Ca[lane];
+    float b = (p.Nbx[lane] * Px + p.Nby[lane] * Py + p.Nbz[lane] * Pz) - p.Cb[lane];
+    if (!(a >= 0 && b >= 0 && a + b <= 1)) return NAN;
+
+    return tHit;
+}
+
+int TrianglePacket::intersectScalar(vec3 rayStart, vec3 rayDir, float tmin, float &t) const
+{
+    int hitLane = -1;
+    float best = t;
+    for (int lane = 0; lane < WIDTH; ++lane) {
+        float tHit = laneHit(*this, lane, rayStart, rayDir, tmin, t);
+        if (!isnan(tHit) && (hitLane < 0 || tHit < best)) {
+            best = tHit;
+            hitLane = lane;
+        }
+    }
+    if (hitLane >= 0) t = best;
+    return hitLane;
+}
+
+// lowest set bit of a nonzero lane mask
+static inline int lowestLane(unsigned int bits)
+{
+    int lane = 0;
+    while (!(bits & 1)) {
+        bits >>= 1;
+        ++lane;
+    }
+    return lane;
+}
+
+#if defined(PACKET_AVX2)
+
+// mask of lanes hitting with t in [tmin, t], and their hit distances
+static inline __m256 hitLanes(const TrianglePacket &p, vec3 rayStart, vec3 rayDir, float tmin, float t,
+    __m256 &tHit)
+{
+    __m256 sx = _mm256_set1_ps(rayStart.x), sy = _mm256_set1_ps(rayStart.y), sz = _mm256_set1_ps(rayStart.z);
+    __m256 dx = _mm256_set1_ps(rayDir.x), dy = _mm256_set1_ps(rayDir.y), dz = _mm256_set1_ps(rayDir.z);
+    __m256 nx = _mm256_loadu_ps(p.Nx), ny = _mm256_loadu_ps(p.Ny), nz = _mm256_loadu_ps(p.Nz);
+
+    __m256 num = _mm256_sub_ps(_mm256_loadu_ps(p.V0_dot_N), _mm256_add_ps(_mm256_add_ps(
+        _mm256_mul_ps(nx, sx), _mm256_mul_ps(ny, sy)), _mm256_mul_ps(nz, sz)));
+    __m256 den = _mm256_add_ps(_mm256_add_ps(
+        _mm256_mul_ps(nx, dx), _mm256_mul_ps(ny, dy)), _mm256_mul_ps(nz, dz));
+    tHit = _mm256_div_ps(num, den);
+
+    __m256 px = _mm256_add_ps(sx, _mm256_mul_ps(dx, tHit));
+    __m256 py = _mm256_add_ps(sy, _mm256_mul_ps(dy, tHit));
+    __m256 pz = _mm256_add_ps(sz, _mm256_mul_ps(dz, tHit));
+    __m256 a = _mm256_sub_ps(_mm256_add_ps(_mm256_add_ps(
+        _mm256_mul_ps(_mm256_loadu_ps(p.Nax), px), _mm256_mul_ps(_mm256_loadu_ps(p.Nay), py)),
+        _mm256_mul_ps(_mm256_loadu_ps(p.Naz), pz)), _mm256_loadu_ps(p.Ca));
+    __m256 b = _mm256_sub_ps(_mm256_add_ps(_mm256_add_ps(
+        _mm256_mul_ps(_mm256_loadu_ps(p.Nbx), px), _mm256_mul_ps(_mm256_loadu_ps(p.Nby), py)),
+        _mm256_mul_ps(_mm256_loadu_ps(p.Nbz), pz)), _mm256_loadu_ps(p.Cb));
+
+    __m256 zero = _mm256_setzero_ps();
+    __m256 hit = _mm256_and_ps(
+        _mm256_and_ps(_mm256_cmp_ps(tHit, _mm256_set1_ps(tmin), _CMP_GE_OQ),
+                      _mm256_cmp_ps(tHit, _mm256_set1_ps(t), _CMP_LE_OQ)),
+        _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(a, zero, _CMP_GE_OQ), _mm256_cmp_ps(b, zero, _CMP_GE_OQ)),
+                      _mm256_cmp_ps(_mm256_add_ps(a, b), _mm256_set1_ps(1), _CMP_LE_OQ)));
+    return hit;
+}
+
+int TrianglePacket::intersect(vec3 rayStart, vec3 rayDir, float tmin, float &t) const
+{
+    __m256 tHit;
+    __m256 hit = hitLanes(*this, rayStart, rayDir, tmin, t, tHit);
+    if (!_mm256_movemask_ps(hit)) return -1;
+
+    // nearest hit across all lanes
+    __m256 near = _mm256_blendv_ps(_mm256_set1_ps(INFINITY), tHit, hit);
+    __m256 m = _mm256_min_ps(near, _mm256_permute2f128_ps(near, near, 1));
+    m = _mm256_min_ps(m, _mm256_shuffle_ps(m, m, _MM_SHUFFLE(1, 0, 3, 2)));
+    m = _mm256_min_ps(m, _mm256_shuffle_ps(m, m, _MM_SHUFFLE(2, 3, 0, 1)));
+    unsigned int bits = _mm256_movemask_ps(_mm256_and_ps(hit, _mm256_cmp_ps(near, m, _CMP_EQ_OQ)));
+
+    t = _mm256_cvtss_f32(m);
+    return lowestLane(bits);
+}
+
+const char *TrianglePacket::kernel() { return "AVX2"; }
+
+#elif defined(PACKET_SSE)
+
+// hit distances for four lanes starting at first, infinity where they miss
+static inline __m128 nearest4(const TrianglePacket &p, int first,
+    __m128 sx, __m128 sy, __m128 sz, __m128 dx, __m128 dy, __m128 dz, float tmin, float t, int &bits)
+{
+    __m128 nx = _mm_loadu_ps(p.Nx + first), ny = _mm_loadu_ps(p.Ny + first), nz = _mm_loadu_ps(p.Nz + first);
+
+    __m128 num = _mm_sub_ps(_mm_loadu_ps(p.V0_dot_N + first), _mm_add_ps(_mm_add_ps(
+        _mm_mul_ps(nx, sx), _mm_mul_ps(ny, sy)), _mm_mul_ps(nz, sz)));
+    __m128 den = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, dx), _mm_mul_ps(ny, dy)), _mm_mul_ps(nz, dz));
+    __m128 tHit = _mm_div_ps(num, den);
+
+    __m128 px = _mm_add_ps(sx, _mm_mul_ps(dx, tHit));
+    __m128 py = _mm_add_ps(sy, _mm_mul_ps(dy, tHit));
+    __m128 pz = _mm_add_ps(sz, _mm_mul_ps(dz, tHit));
+    __m128 a = _mm_sub_ps(_mm_add_ps(_mm_add_ps(
+        _mm_mul_ps(_mm_loadu_ps(p.Nax + first), px), _mm_mul_ps(_mm_loadu_ps(p.Nay + first), py)),
+        _mm_mul_ps(_mm_loadu_ps(p.Naz + first), pz)), _mm_loadu_ps(p.Ca + first));
+    __m128 b = _mm_sub_ps(_mm_add_ps(_mm_add_ps(
+        _mm_mul_ps(_mm_loadu_ps(p.Nbx + first), px), _mm_mul_ps(_mm_loadu_ps(p.Nby + first), py)),
+        _mm_mul_ps(_mm_loadu_ps(p.Nbz + first), pz)), _mm_loadu_ps(p.Cb + first));
+
+    __m128 zero = _mm_setzero_ps();
+    __m128 hit = _mm_and_ps(
+        _mm_and_ps(_mm_cmpge_ps(tHit, _mm_set1_ps(tmin)), _mm_cmple_ps(tHit, _mm_set1_ps(t))),
+        _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(a, zero), _mm_cmpge_ps(b, zero)),
+                   _mm_cmple_ps(_mm_add_ps(a, b), _mm_set1_ps(1))));
+    bits = _mm_movemask_ps(hit);
+    return _mm_or_ps(_mm_and_ps(hit, tHit), _mm_andnot_ps(hit, _mm_set1_ps(INFINITY)));
+}
+
+int TrianglePacket::intersect(vec3 rayStart, vec3 rayDir, float tmin, float &t) const
+{
+    __m128 sx = _mm_set1_ps(rayStart.x), sy = _mm_set1_ps(rayStart.y), sz = _mm_set1_ps(rayStart.z);
+    __m128 dx = _mm_set1_ps(rayDir.x), dy = _mm_set1_ps(rayDir.y), dz = _mm_set1_ps(rayDir.z);
+    int lowBits, highBits;
+    __m128 low = nearest4(*this, 0, sx, sy, sz, dx, dy, dz, tmin, t, lowBits);
+    __m128 high = nearest4(*this, 4, sx, sy, sz, dx, dy, dz, tmin, t, highBits);
+    if (!(lowBits | highBits)) return -1;
+
+    // nearest hit across all lanes
+    __m128 m = _mm_min_ps(low, high);
+    m = _mm_min_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 0, 3, 2)));
+    m = _mm_min_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 3, 0, 1)));
+    unsigned int bits = (lowBits & _mm_movemask_ps(_mm_cmpeq_ps(low, m)))
+        | (highBits & _mm_movemask_ps(_mm_cmpeq_ps(high, m))) << 4;
+
+    t = _mm_cvtss_f32(m);
+    return lowestLane(bits);
+}
+
+const char *TrianglePacket::kernel() { return "SSE"; }
+
+#else
+
+int TrianglePacket::intersect(vec3 rayStart, vec3 rayDir, float tmin, float &t) const
+{
+    return intersectScalar(rayStart, rayDir, tmin, t);
+}
+
+const char *TrianglePacket::kernel() { return "scalar"; }
+
+#endif
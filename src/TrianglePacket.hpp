@@ -0,0 +1,52 @@
+// eight triangles precomputed for ray intersection, stored by component
+//
+// Each field holds one value for all eight triangles, so one SIMD load
+// fetches it for the whole packet. intersect() tests all eight at once
+// with AVX2 when built for it (GLAPP_AVX2), as two SSE halves on other
+// x86 builds, and one at a time elsewhere. Unused lanes hold NaN, which
+// fails every comparison in the test.
+#pragma once
+
+#include <glm/glm.hpp>
+#include <stddef.h>
+#include <vector>
+
+struct TrianglePacket {
+    enum { WIDTH = 8 };
+
+    float Nx[WIDTH], Ny[WIDTH], Nz[WIDTH], V0_dot_N[WIDTH];    // plane normal & offset
+    float Nax[WIDTH], Nay[WIDTH], Naz[WIDTH], Ca[WIDTH];       // alpha = dot(Na, P) - Ca
+    float Nbx[WIDTH], Nby[WIDTH], Nbz[WIDTH], Cb[WIDTH];       // beta = dot(Nb, P) - Cb
+
+    // one triangle's intersection data
+    struct Face {
+        glm::vec3 N; float V0_dot_N;
+        glm::vec3 Na; float Ca;
+        glm::vec3 Nb; float Cb;
+    };
+
+    // packet with every lane unused
+    TrianglePacket();
+
+    // precompute intersection data for one triangle
+    static Face face(glm::vec3 v0, glm::vec3 v1, glm::vec3 v2);
+
+    // copy a triangle into or out of one lane
+    void set(int lane, const Face &f);
+    Face get(int lane) const;
+
+    // append packets for triangles formed by each 3 indices
+    // the last packet is padded with unused lanes
+    static void build(const glm::vec3 *vert, const unsigned int *indices, size_t numIndices,
+        std::vector<TrianglePacket> &packets);
+
+    // nearest hit with t in [tmin, t], lowest lane on ties
+    // on a hit, sets t and returns the lane, otherwise returns -1
+    int intersect(glm::vec3 rayStart, glm::vec3 rayDir, float tmin, float &t) const;
+
+    // same test one lane at a time, the reference for intersect()
+    int intersectScalar(glm::vec3 rayStart, glm::vec3 rayDir, float tmin, float &t) const;
+
+    // name of the instruction set intersect() uses
+    static const char *kernel();
+};
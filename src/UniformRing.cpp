@@ -0,0 +1,102 @@
+// uniform buffer written once per frame, in a ring of frame-sized sections
+
+#include "UniformRing.hpp"
+#include "GLState.hpp"
+#include "TextureResidency.hpp"
+
+#include <GL/glew.h>
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+UniformRing::UniformRing() :
+    bufferID(0), frameBytes(0), alignment(256), frame(0), mapped(nullptr), used(0), waits(0)
+{
+    for (auto &fence : fences)
+        fence = nullptr;
+}
+
+void UniformRing::release()
+{
+    for (auto &fence : fences) {
+        if (fence) glDeleteSync(fence);
+        fence = nullptr;
+    }
+    if (bufferID) glDeleteBuffers(1, &bufferID);
+    bufferID = 0;
+    TextureResidency::shared().removeBuffer(FRAMES * frameBytes);
+    frameBytes = 0;
+}
+
+void UniformRing::beginFrame(size_t blocks, size_t blockBytes)
+{
+    assert(!mapped);
+    GLState &gl = GLState::shared();
+    if (!bufferID) {
+        GLint offsetAlignment = 0;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &offsetAlignment);
+        if (offsetAlignment > 0) alignment = size_t(offsetAlignment);
+        glGenBuffers(1, &bufferID);
+    }
+
+    size_t bytes = blocks * aligned(blockBytes);
+    if (bytes > frameBytes) {
+        // new storage, so no section is still in use
+        for (auto &fence : fences) {
+            if (fence) glDeleteSync(fence);
+            fence = nullptr;
+        }
+        TextureResidency::shared().addBuffer(FRAMES * (bytes - frameBytes));
+        frameBytes = bytes;
+        gl.bindBuffer(GL_UNIFORM_BUFFER, bufferID);
+        glBufferData(GL_UNIFORM_BUFFER, FRAMES * frameBytes, nullptr, GL_STREAM_DRAW);
+    }
+
+    // wait until the GPU is done with this section's last frame
+    frame = (frame + 1) % FRAMES;
+    if (GLsync fence = fences[frame]) {
+        if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+            ++waits;
+            while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED);
+        }
+        glDeleteSync(fence);
+        fences[frame] = nullptr;
+    }
+
+    used = 0;
+    if (!frameBytes) return;
+    gl.bindBuffer(GL_UNIFORM_BUFFER, bufferID);
+    mapped = (char*)glMapBufferRange(GL_UNIFORM_BUFFER, frame * frameBytes, frameBytes,
+        GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+    if (!mapped)
+        fprintf(stderr, "can't map uniform ring section %d, object uniforms not updated\n", frame);
+}
+
+size_t UniformRing::write(const void *data, size_t bytes)
+{
+    assert(used + bytes <= frameBytes);
+    size_t offset = used;
+    if (mapped) memcpy(mapped + offset, data, bytes);
+    used += aligned(bytes);
+    return frame * frameBytes + offset;
+}
+
+void UniformRing::unmap()
+{
+    if (!mapped) return;
+    GLState::shared().bindBuffer(GL_UNIFORM_BUFFER, bufferID);
+    glUnmapBuffer(GL_UNIFORM_BUFFER);
+    mapped = nullptr;
+}
+
+void UniformRing::endFrame()
+{
+    if (fences[frame]) glDeleteSync(fences[frame]);
+    fences[frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void UniformRing::bind(unsigned int index, size_t offset, size_t bytes) const
+{
+    GLState::shared().bindBufferRange(GL_UNIFORM_BUFFER, index, bufferID, offset, bytes);
+}
@@ -0,0 +1,61 @@
+// uniform buffer written once per frame, in a ring of frame-sized sections
+//
+// Each frame maps its own section unsynchronized, so writing never waits
+// on draws still reading earlier frames. A fence per section makes sure
+// the GPU has finished with it before it comes around again. Draws bind
+// their block's range of the shared buffer.
+#pragma once
+
+#include <stddef.h>
+
+class UniformRing {
+public:
+    // sections in flight: one being written, the rest possibly being drawn
+    enum { FRAMES = 3 };
+
+    unsigned int bufferID;      // GL uniform buffer holding all sections, 0 until used
+    size_t frameBytes;          // size of each section
+    size_t alignment;           // GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+
+private:
+    struct __GLsync *fences[FRAMES];    // GPU done with each section
+    int frame;                  // section used this frame
+    char *mapped;               // mapped section, nullptr when not writing
+    size_t used;                // bytes written this frame
+
+public:
+    // statistics since startup
+    unsigned int waits;         // frames that had to wait for the GPU
+
+public:
+    // GL objects are created on first use, so this can be built before GL
+    UniformRing();
+    ~UniformRing() { release(); }
+
+    // free buffer & fences, before the GL context goes away
+    void release();
+
+    // ring owns GL objects, so no copies
+    UniformRing(const UniformRing &) = delete;
+    UniformRing &operator=(const UniformRing &) = delete;
+
+    // map the next section for writing, growing it to hold blocks uniform
+    // blocks of blockBytes each
+    void beginFrame(size_t blocks, size_t blockBytes);
+
+    // bytes rounded up to the offset alignment
+    size_t aligned(size_t bytes) const { return (bytes + alignment - 1) / alignment * alignment; }
+
+    // copy a uniform block into this frame's section
+    // returns its offset in the buffer, for bind()
+    size_t write(const void *data, size_t bytes);
+
+    // finish writing, before drawing from this frame's section
+    void unmap();
+
+    // bind a block written this frame to a uniform block index
+    void bind(unsigned int index, size_t offset, size_t bytes) const;
+
+    // fence this frame's section, after its last draw
+    void endFrame();
+};
@@ -0,0 +1,60 @@
+// assign one GPU vertex to each distinct (v, vt, vn) .obj index triple
+
+#include "VertexWelder.hpp"
+
+#include <stdint.h>
+
+// mix all three indices, so triples differing in any one spread out
+static inline size_t hashTriple(unsigned int v, unsigned int vt, unsigned int vn)
+{
+    uint64_t h = v * 0x9E3779B97F4A7C15ull;
+    h ^= (vt + 0x632BE59BD9B4E019ull) * 0xC2B2AE3D27D4EB4Full;
+    h ^= (vn + 0x85EBCA77C2B2AE63ull) * 0x165667B19E3779F9ull;
+    h ^= h >> 29;
+    h *= 0xBF58476D1CE4E5B9ull;
+    return size_t(h ^ (h >> 32));
+}
+
+VertexWelder::VertexWelder(Arena &arena, size_t expected) :
+    slots(arena), count(0)
+{
+    // keep load under 1/2 for short probe sequences
+    size_t size = 16;
+    while (size < 2 * expected) size *= 2;
+    slots.assign(size, {EMPTY, 0, 0, 0});
+}
+
+unsigned int VertexWelder::weld(unsigned int v, unsigned int vt, unsigned int vn, bool &isNew)
+{
+    size_t mask = slots.size() - 1;
+    for (size_t i = hashTriple(v, vt, vn) & mask;; i = (i + 1) & mask) {
+        Slot &slot = slots[i];
+        if (slot.v == v && slot.vt == vt && slot.vn == vn) {
+            isNew = false;
+            return slot.vertex;
+        }
+        if (slot.v == EMPTY) {
+            slot = {v, vt, vn, count};
+            isNew = true;
+            unsigned int vertex = count++;
+
+            // grow past 3/4 full
+            if (4 * size_t(count) > 3 * slots.size()) grow();
+            return vertex;
+        }
+    }
+}
+
+void VertexWelder::grow()
+{
+    ArenaVector<Slot> old(2 * slots.size(), {EMPTY, 0, 0, 0}, slots.get_allocator());
+    old.swap(slots);
+
+    size_t mask = slots.size() - 1;
+    for (const Slot &slot : old) {
+        if (slot.v == EMPTY) continue;
+        size_t i = hashTriple(slot.v, slot.vt, slot.vn) & mask;
+        while (slots[i].v != EMPTY) i = (i + 1) & mask;
+        slots[i] = slot;
+    }
+}
@@ -0,0 +1,38 @@
+// assign one GPU vertex to each distinct (v, vt, vn) .obj index triple
+#pragma once
+
+#include "Arena.hpp"
+#include <stddef.h>
+
+class VertexWelder {
+public:
+    enum : unsigned int { EMPTY = ~0u };    // v index of an unused slot
+
+private:
+    // open addressing hash table with linear probing
+    struct Slot {
+        unsigned int v, vt, vn;             // key
+        unsigned int vertex;                // welded vertex index
+    };
+    ArenaVector<Slot> slots;                // power of 2 size
+    unsigned int count;                     // vertices assigned so far
+
+public:
+    // size table for about expected distinct triples
+    // table memory comes from arena, including copies left behind by growth
+    VertexWelder(Arena &arena, size_t expected = 0);
+
+    // vertex for this triple, assigning the next one if it's new
+    // isNew tells the caller to append the vertex data
+    unsigned int weld(unsigned int v, unsigned int vt, unsigned int vn, bool &isNew);
+
+    // number of distinct vertices
+    unsigned int size() const { return count; }
+
+    // bytes used by the table
+    size_t memory() const { return slots.size() * sizeof(Slot); }
+
+private:
+    // double table size and reinsert
+    void grow();
+};